@@ -144,4 +144,19 @@ class ConvertUTC
     }
     else return false;
   }
+
+  // Return the UTC time in seconds since 1/1/1970 (epoch time)
+  // year - full year (e.g. 2018), month - 1..12, day - 1..31
+  // Counts the days with the month shifted to start in March, so the leap day is the last day of the year
+  static unsigned long epochTime(int year, int month, int day, int hour, int minute, int second)
+  {
+    if (month <= 2) year -= 1;                                      // January and February belong to the previous (March based) year
+    long era = year / 400;
+    long yearOfEra = year - era * 400;                                                  // 0 - 399
+    long dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;          // 0 - 365
+    long dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;      // 0 - 146096
+    long days = era * 146097 + dayOfEra - 719468;                                       // Days since 1/1/1970
+  
+    return (unsigned long)days * 86400UL + hour * 3600UL + minute * 60UL + second;
+  }
 };
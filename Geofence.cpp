@@ -0,0 +1,352 @@
+/*
+  Geofence.cpp - implementation of the geofence zones and depot waypoints.
+
+  Zones file format (one zone per line, '#' - comment):
+  Z, name, lat1, lng1, lat2, lng2, lat3, lng3, ...            Polygon zone (at least 3 vertices)
+  D, name, lat, lng, radius (m)                               Depot waypoint (circle)
+  Any other line (a header, a comment) is ignored.
+*/
+
+#include "Arduino.h"
+#include "Geofence.h"
+
+static const float metersPerDegree = 111320.0;                // Length of one degree of latitude
+static const float minCellSize = 0.0001;                      // About 11 meters
+
+Geofence::Geofence() {
+  zones = NULL;
+  vertexLat = vertexLng = NULL;
+  names = NULL;
+  bucketStart = bucketItems = largeZones = NULL;
+  insideBits = NULL;
+  inside = NULL;
+  clear();
+}
+
+Geofence::~Geofence() {
+  clear();
+}
+
+void Geofence::clear() {
+  free(zones);
+  free(vertexLat);
+  free(vertexLng);
+  free(names);
+  free(bucketStart);
+  free(bucketItems);
+  free(largeZones);
+  free(insideBits);
+  free(inside);
+  zones = NULL;
+  vertexLat = vertexLng = NULL;
+  names = NULL;
+  bucketStart = bucketItems = largeZones = NULL;
+  insideBits = NULL;
+  inside = NULL;
+  zonesCount = verticesCount = namesLength = 0;
+  bucketsCount = itemsCount = largeZonesCount = 0;
+  cellSize = minCellSize;
+  insideCount = 0;
+  eventsCount = 0;
+}
+
+bool Geofence::allocate(int zonesMax, int verticesMax, long namesMax) {
+  zones = (Zone *)malloc(zonesMax * sizeof(Zone));
+  vertexLat = (float *)malloc(verticesMax * sizeof(float));
+  vertexLng = (float *)malloc(verticesMax * sizeof(float));
+  names = (char *)malloc(namesMax);
+  insideBits = (uint8_t *)calloc((zonesMax + 7) / 8, 1);
+  inside = (uint16_t *)malloc(zonesMax * sizeof(uint16_t));
+  return zones && vertexLat && vertexLng && names && insideBits && inside;
+}
+
+// A line that can be a zone: type Z or D, and a name. Both passes of load() use it, so the second one never adds
+// more zones (or vertices) than the first one counted
+static bool isZoneLine(const String &line) {
+  if (line.length() == 0 || (line[0] != 'Z' && line[0] != 'D')) return false;
+  int nameStart = line.indexOf(',');
+  return nameStart >= 0 && line.indexOf(',', nameStart + 1) >= 0;
+}
+
+int Geofence::load(String path) {
+  clear();
+
+  File file = SD.open((char *)path.c_str());
+  if (!file) {
+    Serial.println("No geofence file (" + path + ")");
+    return 0;
+  }
+
+  // First pass: count the zones, vertices and name lengths, to allocate exactly what the file needs
+  long zonesMax = 0, verticesMax = 0, namesMax = 0;
+  while (file.available()) {
+    String line = file.readStringUntil('\n');
+    line.trim();
+    if (!isZoneLine(line)) continue;
+    int commas = 0, nameStart = -1, nameEnd = -1;
+    for (unsigned int i = 0; i < line.length(); i++)
+      if (line[i] == ',') {
+        if (commas == 0) nameStart = i;
+        else if (commas == 1) nameEnd = i;
+        commas++;
+      }
+    zonesMax++;
+    verticesMax += (line[0] == 'D') ? 1 : commas / 2;
+    namesMax += nameEnd - nameStart;                          // Name and its '\0'
+    yield();
+  }
+  if (zonesMax == 0 || zonesMax > 65535 || verticesMax > 65535) {
+    Serial.println("Geofence: " + String(zonesMax) + " zones, " + String(verticesMax) + " vertices - not loaded");
+    file.close();
+    return 0;
+  }
+  if (!allocate(zonesMax, verticesMax, namesMax)) {
+    Serial.println("Geofence: not enough memory for " + String(zonesMax) + " zones");
+    file.close();
+    clear();
+    return 0;
+  }
+
+  // Second pass: load the zones
+  file.seek(0);
+  while (file.available()) {
+    String line = file.readStringUntil('\n');
+    line.trim();
+    if (isZoneLine(line)) addZone(line);
+    yield();
+  }
+  file.close();
+
+  bool indexed = buildIndex();
+  Serial.println("Geofence: " + String(zonesCount) + " zones, " + String(verticesCount) + " vertices, " +
+                 String(memoryUsed()) + " bytes" + (indexed ? "" : " (not indexed)"));
+  return zonesCount;
+}
+
+void Geofence::addZone(String line) {
+  // Split the line to its fields (type, name, numbers...)
+  char type = line[0];
+  if (type != 'Z' && type != 'D') return;
+  int from = line.indexOf(',');
+  if (from < 0) return;
+  int to = line.indexOf(',', from + 1);
+  if (to < 0) return;
+  String name = line.substring(from + 1, to);
+  name.trim();
+
+  Zone &zone = zones[zonesCount];
+  zone.firstVertex = verticesCount;
+  zone.vertexCount = 0;
+  zone.radius_m = 0;
+
+  float values[3];
+  int valuesCount = 0;
+  while (to >= 0) {
+    from = to;
+    to = line.indexOf(',', from + 1);
+    float value = line.substring(from + 1, (to < 0) ? line.length() : to).toFloat();
+
+    if (type == 'D') {                                        // Depot: lat, lng, radius
+      if (valuesCount < 3) values[valuesCount] = value;
+    }
+    else if (valuesCount % 2 == 0) {                          // Polygon: lat of the next vertex
+      vertexLat[zone.firstVertex + zone.vertexCount] = value;
+    }
+    else {                                                    // Polygon: lng of the vertex
+      vertexLng[zone.firstVertex + zone.vertexCount] = value;
+      zone.vertexCount++;
+    }
+    valuesCount++;
+  }
+
+  if (type == 'D') {
+    if (valuesCount < 3 || values[2] <= 0) return;
+    vertexLat[verticesCount] = values[0];
+    vertexLng[verticesCount] = values[1];
+    zone.vertexCount = 1;
+    zone.radius_m = values[2];
+    float dLat = zone.radius_m / metersPerDegree;
+    float dLng = dLat / cos(radians(values[0]));
+    zone.minLat = values[0] - dLat;
+    zone.maxLat = values[0] + dLat;
+    zone.minLng = values[1] - dLng;
+    zone.maxLng = values[1] + dLng;
+  }
+  else {
+    if (zone.vertexCount < 3) return;
+    zone.minLat = zone.maxLat = vertexLat[zone.firstVertex];
+    zone.minLng = zone.maxLng = vertexLng[zone.firstVertex];
+    for (int v = zone.firstVertex + 1; v < zone.firstVertex + zone.vertexCount; v++) {
+      zone.minLat = min(zone.minLat, vertexLat[v]);
+      zone.maxLat = max(zone.maxLat, vertexLat[v]);
+      zone.minLng = min(zone.minLng, vertexLng[v]);
+      zone.maxLng = max(zone.maxLng, vertexLng[v]);
+    }
+  }
+
+  zone.name = namesLength;
+  memcpy(names + namesLength, name.c_str(), name.length() + 1);
+  namesLength += name.length() + 1;
+  verticesCount += zone.vertexCount;
+  zonesCount++;
+}
+
+int Geofence::bucketOf(long row, long col) {
+  return (((uint32_t)row * 73856093UL) ^ ((uint32_t)col * 19349663UL)) & (bucketsCount - 1);
+}
+
+bool Geofence::buildIndex() {
+  if (zonesCount == 0) return false;
+
+  // Cell size: the average size of a zone, so a zone is on a few cells and a cell has a few zones
+  float sizeSum = 0;
+  for (int z = 0; z < zonesCount; z++)
+    sizeSum += max(zones[z].maxLat - zones[z].minLat, zones[z].maxLng - zones[z].minLng);
+  cellSize = max(sizeSum / zonesCount, minCellSize);
+
+  bucketsCount = 16;
+  while (bucketsCount < 2 * zonesCount && bucketsCount < 16384) bucketsCount *= 2;
+
+  // Count the (zone, cell) pairs. The index has 16 bit offsets, so grow the cells until they fit
+  long items;
+  while (true) {
+    items = 0;
+    largeZonesCount = 0;
+    for (int z = 0; z < zonesCount; z++) {
+      long cells = (long)(floor(zones[z].maxLat / cellSize) - floor(zones[z].minLat / cellSize) + 1) *
+                   (long)(floor(zones[z].maxLng / cellSize) - floor(zones[z].minLng / cellSize) + 1);
+      if (cells > MAX_ZONE_CELLS) largeZonesCount++;
+      else items += cells;
+    }
+    if (items <= 65535) break;
+    cellSize *= 2;
+  }
+
+  bucketStart = (uint16_t *)malloc((bucketsCount + 1) * sizeof(uint16_t));
+  bucketItems = (uint16_t *)malloc(max(items, 1L) * sizeof(uint16_t));
+  largeZones = (uint16_t *)malloc(max(largeZonesCount, 1) * sizeof(uint16_t));
+  if (!bucketStart || !bucketItems || !largeZones) {          // Not enough memory: test every zone
+    free(bucketStart);
+    free(bucketItems);
+    free(largeZones);
+    bucketStart = bucketItems = largeZones = NULL;
+    bucketsCount = largeZonesCount = 0;
+    return false;
+  }
+  itemsCount = items;
+
+  // Count the zones of each bucket, then turn the counts into the start of each bucket's list and fill the lists
+  for (int b = 0; b <= bucketsCount; b++) bucketStart[b] = 0;
+  for (int pass = 0; pass < 2; pass++) {
+    largeZonesCount = 0;
+    for (int z = 0; z < zonesCount; z++) {
+      long row0 = floor(zones[z].minLat / cellSize), row1 = floor(zones[z].maxLat / cellSize);
+      long col0 = floor(zones[z].minLng / cellSize), col1 = floor(zones[z].maxLng / cellSize);
+      if ((row1 - row0 + 1) * (col1 - col0 + 1) > MAX_ZONE_CELLS) {
+        if (pass == 1) largeZones[largeZonesCount] = z;
+        largeZonesCount++;
+        continue;
+      }
+      for (long row = row0; row <= row1; row++)
+        for (long col = col0; col <= col1; col++) {
+          int b = bucketOf(row, col);
+          if (pass == 0) bucketStart[b + 1]++;
+          else bucketItems[bucketStart[b]++] = z;             // bucketStart[b] is used as the fill position of bucket b
+        }
+    }
+    if (pass == 0)
+      for (int b = 0; b < bucketsCount; b++) bucketStart[b + 1] += bucketStart[b];
+  }
+  for (int b = bucketsCount; b > 0; b--) bucketStart[b] = bucketStart[b - 1];   // Undo the fill positions
+  bucketStart[0] = 0;
+  return true;
+}
+
+bool Geofence::contains(int z, float lat, float lng) {
+  const Zone &zone = zones[z];
+  if (lat < zone.minLat || lat > zone.maxLat || lng < zone.minLng || lng > zone.maxLng) return false;
+
+  if (zone.radius_m > 0) {                                    // Depot: distance from the center (equirectangular approximation)
+    float dy = (lat - vertexLat[zone.firstVertex]) * metersPerDegree;
+    float dx = (lng - vertexLng[zone.firstVertex]) * metersPerDegree * cos(radians(lat));
+    return dx * dx + dy * dy <= zone.radius_m * zone.radius_m;
+  }
+
+  // Polygon: count the edges that a ray from the point crosses (odd - inside)
+  bool in = false;
+  int last = zone.firstVertex + zone.vertexCount - 1;
+  for (int i = zone.firstVertex, j = last; i <= last; j = i++) {
+    if (((vertexLat[i] > lat) != (vertexLat[j] > lat)) &&
+        (lng < (vertexLng[j] - vertexLng[i]) * (lat - vertexLat[i]) / (vertexLat[j] - vertexLat[i]) + vertexLng[i]))
+      in = !in;
+  }
+  return in;
+}
+
+int Geofence::update(float lat, float lng) {
+  eventsCount = 0;
+  if (zonesCount == 0) return 0;
+
+  // Left: inside before but not now. When there are more events than MAX_ZONE_EVENTS, the state of the zone isn't
+  // changed, so the event is reported by the next update
+  for (int i = 0; i < insideCount && eventsCount < MAX_ZONE_EVENTS;) {
+    int z = inside[i];
+    if (contains(z, lat, lng)) {
+      i++;
+      continue;
+    }
+    events[eventsCount] = z;
+    eventsEntered[eventsCount++] = false;
+    insideBits[z / 8] &= ~(1 << (z % 8));
+    inside[i] = inside[--insideCount];
+  }
+
+  // Entered: inside now but not before. Only the zones of the grid cell of the position (and the large zones) can contain it.
+  // A zone that is in a bucket more than once (hashed cells) is inside after its first test, so it isn't reported twice
+  const uint16_t *candidates[2];
+  int candidatesCount[2];
+  if (bucketStart) {
+    int b = bucketOf(floor(lat / cellSize), floor(lng / cellSize));
+    candidates[0] = bucketItems + bucketStart[b];
+    candidatesCount[0] = bucketStart[b + 1] - bucketStart[b];
+    candidates[1] = largeZones;
+    candidatesCount[1] = largeZonesCount;
+  }
+  else {                                                      // Not indexed: test every zone
+    candidates[0] = candidates[1] = NULL;
+    candidatesCount[0] = zonesCount;
+    candidatesCount[1] = 0;
+  }
+  for (int list = 0; list < 2; list++)
+    for (int i = 0; i < candidatesCount[list] && eventsCount < MAX_ZONE_EVENTS; i++) {
+      int z = candidates[list] ? candidates[list][i] : i;
+      if ((insideBits[z / 8] & (1 << (z % 8))) || !contains(z, lat, lng)) continue;
+      events[eventsCount] = z;
+      eventsEntered[eventsCount++] = true;
+      insideBits[z / 8] |= 1 << (z % 8);
+      inside[insideCount++] = z;
+    }
+  return eventsCount;
+}
+
+bool Geofence::eventEntered(int i) {
+  return eventsEntered[i];
+}
+
+bool Geofence::eventIsDepot(int i) {
+  return zones[events[i]].radius_m > 0;
+}
+
+const char* Geofence::eventName(int i) {
+  return names + zones[events[i]].name;
+}
+
+int Geofence::zoneCount() {
+  return zonesCount;
+}
+
+unsigned long Geofence::memoryUsed() {
+  return zonesCount * sizeof(Zone) + verticesCount * 2 * sizeof(float) + namesLength +
+         (zonesCount + 7) / 8 + zonesCount * sizeof(uint16_t) +
+         (bucketStart ? (bucketsCount + 1 + itemsCount + largeZonesCount) * sizeof(uint16_t) : 0);
+}
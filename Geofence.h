@@ -0,0 +1,69 @@
+/*
+  Geofence.h - Library for the geofence zones and depot waypoints.
+  Zones are loaded from a file on the SD card and indexed by a hashed grid, so each fix is tested
+  only against the zones that overlap its grid cell. All the memory is allocated by load(), sized from the file.
+*/
+#ifndef Geofence_h
+#define Geofence_h
+
+#include <SD.h>
+
+#include "Arduino.h"
+
+#define MAX_ZONE_EVENTS 16                                    // Events reported by one update(). More are reported by the next updates
+#define MAX_ZONE_CELLS 16                                     // A zone over more grid cells than this is tested on every fix instead
+
+class Geofence
+{
+  public:
+    Geofence();
+    ~Geofence();
+    int load(String path);                                    // Load the zones from a file and build the index. Returns the number of zones
+    int update(float lat, float lng);                         // Check a new position. Returns the number of enter/exit events
+    bool eventEntered(int i);                                 // true - entered (arrived), false - left
+    bool eventIsDepot(int i);
+    const char* eventName(int i);
+    int zoneCount();
+    unsigned long memoryUsed();                               // Bytes allocated by load()
+  private:
+    struct Zone {
+      float minLat, minLng, maxLat, maxLng;                   // Bounding box
+      float radius_m;                                         // Depot radius (meters). 0 - polygon zone
+      uint16_t firstVertex, vertexCount;                      // Polygon vertices (depot - its center)
+      uint32_t name;                                          // Offset of the name in names
+    };
+    Zone *zones;
+    int zonesCount;
+    float *vertexLat, *vertexLng;
+    int verticesCount;
+    char *names;
+    long namesLength;
+
+    // The grid has square cells of cellSize degrees, sized from the zones (not from their bounds, so one far away
+    // zone doesn't stretch it). The cells are hashed into buckets: zones of bucket b are
+    // bucketItems[bucketStart[b]] .. bucketItems[bucketStart[b + 1] - 1]
+    float cellSize;
+    int bucketsCount;                                         // Power of 2
+    uint16_t *bucketStart;
+    uint16_t *bucketItems;
+    int itemsCount;
+    uint16_t *largeZones;                                     // Zones over more than MAX_ZONE_CELLS cells
+    int largeZonesCount;
+
+    // Zones the position is inside of: a bit per zone, and their list (to find the zones that were left)
+    uint8_t *insideBits;
+    uint16_t *inside;
+    int insideCount;
+    uint16_t events[MAX_ZONE_EVENTS];
+    bool eventsEntered[MAX_ZONE_EVENTS];
+    int eventsCount;
+
+    void clear();
+    bool allocate(int zones, int vertices, long namesLength);
+    void addZone(String line);
+    bool buildIndex();
+    int bucketOf(long row, long col);
+    bool contains(int zone, float lat, float lng);
+};
+
+#endif
@@ -0,0 +1,40 @@
+/*
+  LogFormat.h - Definitions of the log file records.
+  Shared by the firmware and the host tools (tools/logingest), so keep it free of Arduino code.
+*/
+#ifndef LogFormat_h
+#define LogFormat_h
+
+#define LOG_DIRECTORY "gpslog"                                // Log files are LOG_DIRECTORY/YYYYMMDD.txt (local date)
+
+#define LOG_TRACKPOINT 'T'                                    // Record types (first field of a line)
+#define LOG_WAYPOINT 'W'
+
+#define LOG_PADDING ' '                                       // The unused (preallocated) end of a log file is filled with this character
+#define LOG_BLOCK_SIZE 512                                    // SD card sector size
+
+// The end of the logged data is found by a binary search for the first block that is LOG_PADDING only (findLogEnd()).
+// So the records must never have a run of LOG_BLOCK_SIZE or more LOG_PADDING characters (e.g. the padding of the
+// track summary), or a block of it could be taken for the padding of the file and the data after it truncated
+
+#define LOG_HEADER "type, new_track, latitude, longitude, time, satellites, elevation (m), speed (kmph), course, elapsed time, total distance (km), description, color"
+
+// Fields of a record line, comma separated. Waypoints leave the fields between time and description empty
+enum LogField {
+  LOG_FIELD_TYPE,
+  LOG_FIELD_NEW_TRACK,                                        // 1 - first point of a new track, 0 - same track
+  LOG_FIELD_LATITUDE,
+  LOG_FIELD_LONGITUDE,
+  LOG_FIELD_TIME,                                             // Local time, HH:MM:SS
+  LOG_FIELD_SATELLITES,
+  LOG_FIELD_ELEVATION,                                        // Meters
+  LOG_FIELD_SPEED,                                            // kmph
+  LOG_FIELD_COURSE,                                           // Degrees
+  LOG_FIELD_ELAPSED_TIME,                                     // H:MM:SS
+  LOG_FIELD_DISTANCE,                                         // Total distance (km)
+  LOG_FIELD_DESCRIPTION,
+  LOG_FIELD_COLOR,
+  LOG_FIELDS
+};
+
+#endif
@@ -0,0 +1,88 @@
+/*
+  LogPadding.cpp - implementation of the padding of the preallocated log files.
+*/
+
+#include "Arduino.h"
+#include "LogPadding.h"
+
+static bool isPaddingBlock(File &file, unsigned long block)  // Checks if a block (sector) of the log file contains padding only
+{
+  char buf[LOG_BLOCK_SIZE];
+  file.seek(block * LOG_BLOCK_SIZE);
+  int n = file.read((uint8_t *)buf, LOG_BLOCK_SIZE);
+  if (n <= 0) return false;
+  for (int i = 0; i < n; i++)
+    if (buf[i] != LOG_PADDING) return false;
+  return true;
+}
+
+unsigned long findLogEnd(File &file)
+{
+  unsigned long size = file.size();
+  if (size == 0) return 0;
+
+  // The logged data ends with a new line. A file that doesn't end with padding has no padding (already truncated)
+  file.seek(size - 1);
+  if (file.read() != LOG_PADDING) return size;
+
+  // Binary search for the first block that is padding only
+  unsigned long lo = 0, hi = (size + LOG_BLOCK_SIZE - 1) / LOG_BLOCK_SIZE;
+  while (lo < hi)
+  {
+    unsigned long mid = (lo + hi) / 2;
+    if (isPaddingBlock(file, mid)) hi = mid;
+    else lo = mid + 1;
+  }
+
+  // Then scan back over the padding at the end of the last data block
+  unsigned long end = hi * LOG_BLOCK_SIZE;
+  if (end > size) end = size;
+  if (hi > 0)
+  {
+    char buf[LOG_BLOCK_SIZE];
+    unsigned long blockStart = (hi - 1) * LOG_BLOCK_SIZE;
+    file.seek(blockStart);
+    int n = file.read((uint8_t *)buf, end - blockStart);
+    while (n > 0 && buf[n - 1] == LOG_PADDING) n--;
+    end = blockStart + n;
+  }
+  return end;
+}
+
+unsigned long findLogEnd(String path)
+{
+  File file = SD.open((char *)path.c_str());
+  if (!file) return 0;
+  unsigned long end = findLogEnd(file);
+  file.close();
+  return end;
+}
+
+void trimLogFile(String path)
+{
+  File file = SD.open((char *)path.c_str(), FILE_WRITE);
+  if (!file) return;
+  unsigned long end = findLogEnd(file);
+  if (end < file.size()) {
+    Serial.println("Truncating the padding of " + path + " (" + String(file.size() - end) + " bytes)");
+    file.truncate(end);
+  }
+  file.close();
+}
+
+void trimLogFiles(String directory, String keepPath)
+{
+  File dir = SD.open((char *)directory.c_str());
+  if (!dir || !dir.isDirectory()) return;
+  dir.rewindDirectory();
+  while (true) {
+    File entry = dir.openNextFile();
+    if (!entry) break;
+    String path = directory + "/" + entry.name();
+    bool isFile = !entry.isDirectory();
+    entry.close();
+    if (isFile && path != keepPath) trimLogFile(path);
+    yield();
+  }
+  dir.close();
+}
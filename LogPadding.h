@@ -0,0 +1,18 @@
+/*
+  LogPadding.h - Library for the padding of the preallocated log files.
+  A log file is filled with LOG_PADDING when it is created. The padding is always at the end of the file.
+*/
+#ifndef LogPadding_h
+#define LogPadding_h
+
+#include <SD.h>
+
+#include "Arduino.h"
+#include "LogFormat.h"
+
+unsigned long findLogEnd(File &file);                         // End of the logged data (the file size if there is no padding)
+unsigned long findLogEnd(String path);
+void trimLogFile(String path);                                // Truncate the padding of a log file
+void trimLogFiles(String directory, String keepPath);         // Truncate the padding of all the log files in a directory, except keepPath
+
+#endif
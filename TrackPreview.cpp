@@ -0,0 +1,156 @@
+/*
+  TrackPreview.cpp - implementation of the decimated track of a log file.
+*/
+
+#include "Arduino.h"
+#include "TrackPreview.h"
+#include "LogFormat.h"
+#include "LogPadding.h"
+
+TrackPreview::TrackPreview() {
+  vertices = 0;
+  latMin = lngMin = latMax = lngMax = 0;
+  pointsCount = dataSize = 0;
+}
+
+// Parse the latitude and longitude of a track point line. Returns false for any other line
+static bool parseTrackPoint(char *line, float &lat, float &lng, bool &newTrack) {
+  if (line[0] != LOG_TRACKPOINT) return false;
+  char *field[LOG_FIELD_TIME];
+  field[LOG_FIELD_TYPE] = line;
+  for (int i = 1; i < LOG_FIELD_TIME; i++) {
+    field[i] = strchr(field[i - 1], ',');
+    if (!field[i]) return false;
+    field[i]++;
+  }
+  newTrack = atoi(field[LOG_FIELD_NEW_TRACK]) == 1;
+  lat = atof(field[LOG_FIELD_LATITUDE]);
+  lng = atof(field[LOG_FIELD_LONGITUDE]);
+  return true;
+}
+
+void TrackPreview::read(File &file) {
+  unsigned long stride = 1;
+  bool pendingNewTrack = false;                               // A skipped point started a new track. Start it at the next kept point
+  float lastLat = 0, lastLng = 0;
+  bool lastKept = true;
+  vertices = 0;
+  pointsCount = 0;
+  latMin = 90, latMax = -90, lngMin = 180, lngMax = -180;
+
+  // Only the logged data: the padding of a preallocated file (up to 4 MB) has no track points
+  dataSize = findLogEnd(file);
+  file.seek(0);
+  unsigned long remaining = dataSize;
+
+  char buf[LOG_BLOCK_SIZE];
+  char line[160];
+  int lineLength = 0;
+  while (true) {
+    int n = (remaining > 0) ? file.read((uint8_t *)buf, min(remaining, (unsigned long)sizeof(buf))) : 0;
+    if (n > 0) remaining -= n;
+    for (int i = 0; i < n || (n <= 0 && i == 0); i++) {
+      char c = (n > 0) ? buf[i] : '\n';                      // End of the data ends the last line
+      if (c != '\n') {
+        if (lineLength < (int)sizeof(line) - 1) line[lineLength++] = c;  // The rest of a long line (track summary) isn't needed
+        continue;
+      }
+      line[lineLength] = '\0';
+      lineLength = 0;
+
+      float lat, lng;
+      bool isNewTrack;
+      if (!parseTrackPoint(line, lat, lng, isNewTrack)) continue;
+      latMin = min(latMin, lat);
+      latMax = max(latMax, lat);
+      lngMin = min(lngMin, lng);
+      lngMax = max(lngMax, lng);
+      lastLat = lat;
+      lastLng = lng;
+
+      if (pointsCount++ % stride != 0) {
+        pendingNewTrack |= isNewTrack;
+        lastKept = false;
+        continue;
+      }
+      if (vertices == PREVIEW_MAX_POINTS) {                   // Buffer is full: keep every other point and double the stride
+        int j = 0;
+        bool carry = false;
+        for (int k = 0; k < vertices; k++) {
+          if (k % 2) {
+            carry |= vertexNewTrack[k];
+            continue;
+          }
+          vertexLat[j] = vertexLat[k];
+          vertexLng[j] = vertexLng[k];
+          vertexNewTrack[j++] = vertexNewTrack[k] || carry;
+          carry = false;
+        }
+        vertices = j;
+        pendingNewTrack |= carry;
+        stride *= 2;
+        if ((pointsCount - 1) % stride != 0) {                // This point isn't on the new stride
+          pendingNewTrack |= isNewTrack;
+          lastKept = false;
+          continue;
+        }
+      }
+      vertexLat[vertices] = lat;
+      vertexLng[vertices] = lng;
+      vertexNewTrack[vertices] = isNewTrack || pendingNewTrack || vertices == 0;
+      vertices++;
+      pendingNewTrack = false;
+      lastKept = true;
+    }
+    if (n <= 0) break;
+    yield();
+  }
+
+  if (!lastKept) {                                            // Always end at the last point of the track
+    bool startsTrack = pendingNewTrack;
+    if (vertices == PREVIEW_MAX_POINTS) startsTrack |= vertexNewTrack[--vertices];  // Replace the last vertex, but keep the track it starts
+    vertexLat[vertices] = lastLat;
+    vertexLng[vertices] = lastLng;
+    vertexNewTrack[vertices++] = startsTrack;
+  }
+}
+
+int TrackPreview::count() {
+  return vertices;
+}
+
+float TrackPreview::lat(int i) {
+  return vertexLat[i];
+}
+
+float TrackPreview::lng(int i) {
+  return vertexLng[i];
+}
+
+bool TrackPreview::newTrack(int i) {
+  return vertexNewTrack[i];
+}
+
+float TrackPreview::minLat() {
+  return latMin;
+}
+
+float TrackPreview::maxLat() {
+  return latMax;
+}
+
+float TrackPreview::minLng() {
+  return lngMin;
+}
+
+float TrackPreview::maxLng() {
+  return lngMax;
+}
+
+unsigned long TrackPreview::points() {
+  return pointsCount;
+}
+
+unsigned long TrackPreview::bytesRead() {
+  return dataSize;
+}
@@ -0,0 +1,39 @@
+/*
+  TrackPreview.h - Library for the decimated track of a log file (the on-device track preview).
+  The log file is read once, up to its padding, and every stride-th track point is kept. When the buffer is full
+  every other kept point is dropped and the stride is doubled, so any log file gives at most PREVIEW_MAX_POINTS vertices.
+  An object is about 4.6 KB, so allocate it only while it is used.
+*/
+#ifndef TrackPreview_h
+#define TrackPreview_h
+
+#include <SD.h>
+
+#include "Arduino.h"
+
+#define PREVIEW_MAX_POINTS 512
+
+class TrackPreview
+{
+  public:
+    TrackPreview();
+    void read(File &file);                                    // Read the track points of a log file
+    int count();                                              // Number of vertices
+    float lat(int i);
+    float lng(int i);
+    bool newTrack(int i);                                     // The vertex starts a new track (polyline)
+    float minLat();                                           // Bounds of all the track points (not only the vertices)
+    float maxLat();
+    float minLng();
+    float maxLng();
+    unsigned long points();                                   // Track points in the file
+    unsigned long bytesRead();                                // Bytes read from the file (without the padding)
+  private:
+    float vertexLat[PREVIEW_MAX_POINTS], vertexLng[PREVIEW_MAX_POINTS];
+    bool vertexNewTrack[PREVIEW_MAX_POINTS];
+    int vertices;
+    float latMin, latMax, lngMin, lngMax;
+    unsigned long pointsCount, dataSize;
+};
+
+#endif
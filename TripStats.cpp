@@ -0,0 +1,129 @@
+/*
+  TripStats.cpp - implementation of the incremental trip statistics.
+*/
+
+#include "Arduino.h"
+#include "TripStats.h"
+
+static const float movingSpeed = 2.0;                         // Below this speed (kmph) the GPS is considered stopped (speed noise of a standing receiver)
+static const float elevationHysteresis = 5.0;                 // Elevation changes smaller than this (meters) are ignored as GPS noise
+static const unsigned long maxFixGap = 600;                   // A gap between fixes longer than this (seconds, e.g. no signal) is counted as stopped time
+
+TripStats::TripStats() {
+  reset();
+}
+
+void TripStats::reset() {
+  started = false;
+  startEpoch = lastEpoch = 0;
+  moving = stopped = 0;
+  distance_m = 0;
+  speedMax = 0;
+  elevationRef = gain = loss = 0;
+  splits = 0;
+  lastSplitElapsed = 0;
+  splitLast = splitFastest = 0;
+}
+
+void TripStats::update(unsigned long epoch, double distance_km, float speed_kmph, float elevation_m) {
+  if (!started) {                                             // First fix of the trip
+    started = true;
+    startEpoch = lastEpoch = epoch;
+    elevationRef = elevation_m;
+    return;
+  }
+  if (epoch <= lastEpoch) return;                             // Same or older fix, nothing to add
+
+  unsigned long dt = epoch - lastEpoch;
+  lastEpoch = epoch;
+
+  if (speed_kmph >= movingSpeed && dt <= maxFixGap) moving += dt;
+  else stopped += dt;
+
+  if (speed_kmph > speedMax) speedMax = speed_kmph;
+
+  // Elevation gain/loss with hysteresis: count a change only once it leaves the band around the reference elevation
+  if (elevation_m - elevationRef >= elevationHysteresis) {
+    gain += elevation_m - elevationRef;
+    elevationRef = elevation_m;
+  }
+  else if (elevationRef - elevation_m >= elevationHysteresis) {
+    loss += elevationRef - elevation_m;
+    elevationRef = elevation_m;
+  }
+
+  distance_m += distance_km * 1000.0;
+
+  // Per-km splits. A long gap may complete more than one kilometer in a single fix
+  while (distance_m >= (splits + 1) * 1000.0) {
+    unsigned long elapsed = epoch - startEpoch;
+    unsigned long t = elapsed - lastSplitElapsed;
+    if (t > 65535) t = 65535;
+    if (splits < MAX_SPLITS) splitTimes[splits] = t;
+    splitLast = t;
+    if (splitFastest == 0 || t < splitFastest) splitFastest = t;
+    lastSplitElapsed = elapsed;
+    splits++;
+  }
+}
+
+unsigned long TripStats::elapsedTime() {
+  return lastEpoch - startEpoch;
+}
+
+unsigned long TripStats::movingTime() {
+  return moving;
+}
+
+unsigned long TripStats::stoppedTime() {
+  return stopped;
+}
+
+double TripStats::distance() {
+  return distance_m / 1000.0;
+}
+
+float TripStats::maxSpeed() {
+  return speedMax;
+}
+
+float TripStats::averageSpeed() {
+  if (moving == 0) return 0;
+  return (distance_m / 1000.0) / (moving / 3600.0);
+}
+
+float TripStats::elevationGain() {
+  return gain;
+}
+
+float TripStats::elevationLoss() {
+  return loss;
+}
+
+int TripStats::splitCount() {
+  return splits;
+}
+
+unsigned int TripStats::split(int km) {
+  if (km < 1 || km > splits || km > MAX_SPLITS) return 0;
+  return splitTimes[km - 1];
+}
+
+unsigned int TripStats::lastSplit() {
+  return splitLast;
+}
+
+unsigned int TripStats::fastestSplit() {
+  return splitFastest;
+}
+
+void TripStats::formatTime(unsigned long seconds, char *buf) {
+  unsigned long h = seconds / 3600;
+  int m = (seconds / 60) % 60;
+  int s = seconds % 60;
+  snprintf(buf, 12, "%lu:%02d:%02d", h, m, s);
+}
+
+void TripStats::formatSplit(unsigned int seconds, char *buf) {
+  snprintf(buf, 12, "%u:%02u", seconds / 60, seconds % 60);
+}
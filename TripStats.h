@@ -0,0 +1,45 @@
+/*
+  TripStats.h - Library for the incremental trip statistics.
+  Updated once per logged fix in constant time, without allocations and without parsing strings.
+*/
+#ifndef TripStats_h
+#define TripStats_h
+
+#include "Arduino.h"
+
+#define MAX_SPLITS 32                                         // Number of per-km split times that are kept
+
+class TripStats
+{
+  public:
+    TripStats();
+    void reset();
+    void update(unsigned long epoch, double distance_km, float speed_kmph, float elevation_m);
+    unsigned long elapsedTime();                              // Seconds since the first fix
+    unsigned long movingTime();                               // Seconds
+    unsigned long stoppedTime();                              // Seconds
+    double distance();                                        // Kilometers
+    float maxSpeed();                                         // kmph
+    float averageSpeed();                                     // Average moving speed (kmph)
+    float elevationGain();                                    // Meters
+    float elevationLoss();                                    // Meters
+    int splitCount();                                         // Number of completed kilometers
+    unsigned int split(int km);                               // Time of the km-th kilometer (seconds, 0 if not kept)
+    unsigned int lastSplit();
+    unsigned int fastestSplit();
+    static void formatTime(unsigned long seconds, char *buf); // Format seconds as H:MM:SS (buf - at least 12 chars)
+    static void formatSplit(unsigned int seconds, char *buf); // Format a split as M:SS (buf - at least 12 chars)
+  private:
+    bool started;
+    unsigned long startEpoch, lastEpoch;
+    unsigned long moving, stopped;
+    double distance_m;
+    float speedMax;
+    float elevationRef, gain, loss;
+    int splits;
+    unsigned long lastSplitElapsed;
+    unsigned int splitTimes[MAX_SPLITS];
+    unsigned int splitLast, splitFastest;
+};
+
+#endif
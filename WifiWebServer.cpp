@@ -2,8 +2,14 @@
   WifiWebServer.cpp - implementation of the Wifi Web Server.
 */
 
+#include <memory>
+#include <new>
+
 #include "Arduino.h"
 #include "WifiWebServer.h"
+#include "LogFormat.h"
+#include "LogPadding.h"
+#include "TrackPreview.h"
 
 ESP8266WebServer server(80);
 MDNSResponder mdns; 
@@ -14,6 +20,8 @@ int ssidMaxLength = 32;
 int passMaxLength = 64;
 bool searchForNetworksWebPage = true;
 
+static const int previewSize = 1000;                          // Size of the track preview SVG drawing (longer side)
+
 const char* UTC[40] = {"UTC-12:00","UTC-11:00","UTC-10:00","UTC-09:30","UTC-09:00",
   "UTC-08:00","UTC-07:00","UTC-06:00","UTC-05:00","UTC-04:00","UTC-03:30","UTC-03:00",
   "UTC-02:00","UTC-01:00","UTC","UTC+01:00","UTC+02:00","UTC+03:00","UTC+03:30",
@@ -177,6 +185,70 @@ void printDirectory() {
  dir.close();
 }
 
+// Stream an SVG drawing of the track in a log file, in one pass over the file (up to its padding).
+// The track points are decimated to at most PREVIEW_MAX_POINTS vertices, in a buffer that is allocated only for the request
+void handlePreview(){
+  if(!server.hasArg("file")) return returnFail("BAD ARGS");
+  String path = server.arg("file");
+  File dataFile = SD.open((char *)path.c_str());
+  if(!dataFile || dataFile.isDirectory()) {
+    dataFile.close();
+    return returnFail("BAD PATH");
+  }
+
+  std::unique_ptr<TrackPreview> preview(new (std::nothrow) TrackPreview);
+  if (!preview) {
+    dataFile.close();
+    return returnFail("NOT ENOUGH MEMORY");
+  }
+
+  unsigned long startTime = millis();
+  preview->read(dataFile);
+  dataFile.close();
+  int count = preview->count();
+  float minLat = preview->minLat(), maxLat = preview->maxLat(), minLng = preview->minLng(), maxLng = preview->maxLng();
+
+  // Equirectangular projection, scaled so the longer side is previewSize
+  float lngScale = cos(radians((minLat + maxLat) / 2));
+  float spanX = (maxLng - minLng) * lngScale, spanY = maxLat - minLat;
+  float scale = previewSize / max(max(spanX, spanY), 0.00001f);
+  int width = spanX * scale + 1, height = spanY * scale + 1;
+
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "image/svg+xml", "");
+  unsigned long responseSize = 0;
+
+  String output = "<svg xmlns=\"http://www.w3.org/2000/svg\" viewBox=\"-10 -10 " + String(width + 20) + " " + String(height + 20) + "\">";
+  output += "<g fill=\"none\" stroke=\"blue\" stroke-width=\"3\" stroke-linejoin=\"round\">";
+  for (int i = 0; i < count; i++) {
+    if (preview->newTrack(i)) {
+      if (i > 0) output += "\"/>";
+      output += "<polyline points=\"";
+    }
+    else output += ' ';
+    output += String((int)((preview->lng(i) - minLng) * lngScale * scale));
+    output += ',';
+    output += String((int)((maxLat - preview->lat(i)) * scale));
+    if (output.length() > 1024) {                             // Send in chunks
+      server.sendContent(output);
+      responseSize += output.length();
+      output = String();
+    }
+  }
+  if (count > 0) {
+    output += "\"/></g>";
+    output += "<circle cx=\"" + String((int)((preview->lng(0) - minLng) * lngScale * scale)) + "\" cy=\"" + String((int)((maxLat - preview->lat(0)) * scale)) + "\" r=\"8\" fill=\"green\"/>";
+    output += "<circle cx=\"" + String((int)((preview->lng(count - 1) - minLng) * lngScale * scale)) + "\" cy=\"" + String((int)((maxLat - preview->lat(count - 1)) * scale)) + "\" r=\"8\" fill=\"red\"/>";
+  }
+  else output += "</g><text x=\"0\" y=\"20\">No track points</text>";
+  output += "</svg>";
+  server.sendContent(output);
+  responseSize += output.length();
+
+  Serial.print("Preview of " + path + ": " + String(preview->bytesRead()) + " bytes read, " + String(preview->points()) + " track points, " + String(count) + " vertices, ");
+  Serial.println(String(responseSize) + " bytes, " + String(millis() - startTime) + " ms");
+}
+
 void handleNotFound(){
   if(loadFromSdCard(server.uri())) return;
   String message = "SDCARD Not Detected\n\n";
@@ -222,6 +294,8 @@ void printFiles(String directory, File dir, int numTabs) {
       webPage += "</a>";
       webPage += " (<a href=\"" + directory + "/" + entry.name() + "\" download>";
       webPage += "download";
+      webPage += "</a>, <a href=\"/preview?file=" + directory + "/" + entry.name() + "\">";
+      webPage += "preview";
       webPage += "</a>)";
       webPage += "&#9;";
       webPage += String(entry.size()) + " bytes";
@@ -261,7 +335,7 @@ void handleFiles() {
     webPage += "<form onsubmit=\"return confirm('Are you sure you want to delete all files?');\">\r\n";
     webPage += "<input type=\"submit\" name=\"deleteAll\" value=\"Delete all\">\r\n";
     webPage += "</form>\r\n";
-    webPage += "<p>Go to <a href=\"http://www.gpsvisualizer.com/\">GPS Visualizer</a>: Do-It-Yourself Mapping.";
+    webPage += "<p>Preview a track on the device, or go to <a href=\"http://www.gpsvisualizer.com/\">GPS Visualizer</a>: Do-It-Yourself Mapping.";
     webPage += " Upload a log file to view the route on the map.</p>";
   }
   else
@@ -502,6 +576,8 @@ String WifiWebServer::start() {
   Serial.println("Web server mode");
   Serial.println();
 
+  trimLogFiles(directory, "");                                            // Log files are served (and downloaded) without their preallocated padding
+
   Serial.println("Starting wifi connection...");
 
   Serial.println("Reading EEPROM ssid...");
@@ -576,6 +652,7 @@ String WifiWebServer::start() {
   server.on("/cleareeprom", handleClear);
   server.on("/files", handleFiles);
   server.on("/settings", handleSettings);
+  server.on("/preview", handlePreview);
   
   server.on("/list", HTTP_GET, printDirectory);
   server.on("/edit", HTTP_DELETE, handleDelete);
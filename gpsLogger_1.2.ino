@@ -16,6 +16,10 @@ Using nodeMCU v3.
 Adafruit_SSD1306 display(OLED_RESET);
 
 #include "ConvertUTC.cpp"
+#include "LogFormat.h"                                           // Log file records (shared with the host tools)
+#include "LogPadding.h"                                          // Finding and truncating the padding of the preallocated log files
+#include "TripStats.h"                                           // Trip statistics (elapsed/moving time, speeds, elevation gain/loss and per-km splits)
+#include "Geofence.h"                                            // Geofence zones and depot waypoints (enter/exit events)
 #include "WifiWebServer.h"                                       // wifi library to handle the wireless connection of the NodeMCU (ESP8266) with the surroundings (wifi direct - SoftAP)
 
 static const int RXPin = 4, TXPin = 5;                        // Ublox 6m GPS module to pins 4 and 5
@@ -38,7 +42,7 @@ int mode = 0;                                                 // Mode/state of t
 int counter = 5;                                              // Counter at setup to change to "Web" Mode or not ("GPS Logger" Mode)
 
 static const int setButtonPin = 2;                           // set button pin - 2
-int option = 0;                                               // options of the shown data on display during GPS logger mode (4)
+int option = 0;                                               // options of the shown data on display during GPS logger mode (5 data pages, 5 - display off)
 
 TinyGPSPlus gps;                                              // Create an Instance of the TinyGPS++ object called gps
 SoftwareSerial gpsSerial(RXPin, TXPin);                       // The serial connection to the GPS device
@@ -46,12 +50,29 @@ SoftwareSerial gpsSerial(RXPin, TXPin);                       // The serial conn
 File dataFile;                                                // Files of logging and battery
                          
 String fileName = "20000000.txt";                             // File name format: yyyymmdd
-String directoryName = "gpslog";
+String directoryName = LOG_DIRECTORY;
 String filePath;
 String dateAndTime;
 String date;
+String fileDate;                                              // Local date (YYMMDD) of the open log file, to detect a day rollover
 bool isFileCreated = false;
 
+// Preallocated log file. The daily file is filled with padding (LOG_PADDING), so no FAT clusters are allocated while writing a fix.
+// The file of the first day is preallocated when it is created, before logging starts. After that (a long day, the file of a
+// new day) smartDelay() keeps preallocateLead of padding ahead of the logged data, one step per call. The GPS serial is fed between the blocks
+static const int logRecordSize = 112;                         // Approximate size of a track point line in bytes (used to size the preallocation)
+static const unsigned long maxLogPreallocation = 4194304;     // Preallocate at most 4 MB per day
+static const int preallocateStepBlocks = 8;                   // Blocks of padding written in one step (4 KB)
+static const unsigned long preallocateLead = 65536;           // Padding kept ahead of the logged data while logging (padded up to twice this)
+unsigned long logEndPos = 0;                                  // End of the logged data. Everything after it is padding
+unsigned long logFileSize = 0;                                // Size of the log file, with its padding
+unsigned long logAllocated = 0;                               // Size the log file is being preallocated to (0 - done)
+bool logCardFull = false;                                     // Preallocation stopped: the card is full
+
+bool PrintWriteLatency = false;                               // Debugging per-fix write latency (histogram printed to console)
+static const unsigned long writeLatencyBounds[7] = {1, 2, 5, 10, 20, 50, 100};  // Histogram bucket upper bounds (ms). Last bucket: 100 ms and over
+unsigned long writeLatencyHistogram[8];
+
 static const int UTC = 0;                                     // GPS time is UTC which is zero.
 unsigned long smartDelayTime = 500;
 
@@ -70,18 +91,23 @@ unsigned long start = 0;
 // previous and current Latitude and Longitude and distance
 double prevLat, prevLng, currLat, currLng;
 double distance_km;
-double totalDistance_km;
 
-// Current time of logging and previous time
-int currHour, currMin, currSec;
-int prevHour = -1, prevMin = -1, prevSec = -1;
+// Trip statistics so far (updated on every logged fix)
+TripStats trip;
+char elapsedTimeStr[12] = "0:00:00";                          // Elapsed time of the trip (H:MM:SS)
+
+// Width of the track summary (description) in the log file. It is padded to this width so it can be rewritten in place
+static const int summaryWidth = 760;
+// The shortest summary writeTrackSummary() writes (all zero, no splits). Keep it in sync with writeTrackSummary().
+// The summary is padded with spaces, the same byte as LOG_PADDING, so the padding after it must be shorter than a block (see LogFormat.h)
+static const char summaryShortest[] = ", Total tracking time: <b>0:00:00</b><br>Total distance (km): <b>0.00</b><br>Moving time: <b>0:00:00</b>"
+                                      "<br>Stopped time: <b>0:00:00</b><br>Average moving speed (kmph): <b>0.00</b><br>Max speed (kmph): <b>0.00</b>"
+                                      "<br>Elevation gain/loss (m): <b>+0/-0</b>";
+static_assert(summaryWidth - (int)(sizeof(summaryShortest) - 1) < LOG_BLOCK_SIZE, "The summary padding could be taken for the padding of the log file");
 
-// total time so far
-int totalTime = 0;
-int totalTimeHours = 0;
-int totalTimeMinutes = 0;
-int totalTimeSeconds = 0;
-String totalTimeSecondsStr, totalTimeMinutesStr;
+// Geofence zones and depot waypoints, loaded from the SD card when the GPS logger mode starts
+Geofence geofence;
+String geofencePath = "geofence.txt";
 
 // New (=1) or old track (=0)
 int newTrack = 1;
@@ -127,61 +153,145 @@ void setupDisplay()                                           // Begins and clea
   display.display();*/
 }
 
+void PreallocateStep(unsigned long blocks);
+
+void feedGps()                                                // Pass the received GPS data to the gps object (the serial buffer is only 64 bytes, about 66 ms)
+{
+  while (gpsSerial.available())
+    gps.encode(gpsSerial.read());
+}
+
 void smartDelay(unsigned long ms)                             // This custom version of delay() ensures that the gps object is being "fed".
 {
   unsigned long start = millis();
+  if (logAllocated == 0 && isFileCreated && !logCardFull && logEndPos + preallocateLead > logFileSize)
+    logAllocated = logEndPos + 2 * preallocateLead;           // Running out of padding: pad the file again
+  if (logAllocated != 0)                                      // Use the idle time to preallocate the log file (one step per call)
+    PreallocateStep(preallocateStepBlocks);
   do 
   {
-    while (gpsSerial.available())
-      gps.encode(gpsSerial.read());
+    feedGps();
   } while (millis() - start < ms);
 }
 
+unsigned long logPreallocationSize()                         // Size of the day's log file, from the GPS sample time (preallocated before logging starts)
+{
+  unsigned long samplePeriod = gpsSampleTime + smartDelayTime;                    // Miliseconds between track points
+  unsigned long bytes = (86400000UL / samplePeriod) * logRecordSize;              // One track point per sample time for a whole day
+  if (bytes > maxLogPreallocation) bytes = maxLogPreallocation;
+  return bytes;
+}
+
+void PreallocateStep(unsigned long blocks)                    // Append blocks of padding to the log file, until it reaches logAllocated
+{
+  File file = SD.open((char *)filePath.c_str(), FILE_WRITE);
+  if (!file) {
+    logAllocated = 0;
+    return;
+  }
+  unsigned long size = file.size();
+  char buf[LOG_BLOCK_SIZE];
+  memset(buf, LOG_PADDING, LOG_BLOCK_SIZE);
+  file.seek(size);
+  for (unsigned long i = 0; i < blocks && size < logAllocated; i++)
+  {
+    int n = (logAllocated - size > LOG_BLOCK_SIZE) ? LOG_BLOCK_SIZE : logAllocated - size;
+    if (file.write((uint8_t *)buf, n) != n) {                   // The card is full - log into whatever was allocated
+      Serial.println("Preallocation stopped: card is full");
+      logAllocated = size;
+      logCardFull = true;
+      break;
+    }
+    size += n;
+    feedGps();                                                // A block may allocate a cluster: don't let the GPS serial overflow
+    yield();
+  }
+  file.close();
+  logFileSize = size;
+  if (size >= logAllocated) {
+    Serial.println("Log file preallocated: " + String(size) + " bytes");
+    logAllocated = 0;
+  }
+}
+
+void FinishLogFile()                                          // Truncate the log file to the real length of the logged data (on a day rollover)
+{
+  logAllocated = 0;
+  File file = SD.open((char *)filePath.c_str(), FILE_WRITE);
+  if (file) {
+    if (file.size() > logEndPos) file.truncate(logEndPos);
+    logFileSize = logEndPos;
+    file.close();
+  }
+}
+
 void CreateLogFile(String path, String date)       // Create a new log file
-{                    
+{
   if(SD.exists((char *)path.c_str())) {
     Serial.println("Already created. No need to create a new one.");
+    logEndPos = findLogEnd(path);                             // Continue logging after the data that is already in the file
+    logFileSize = logEndPos;                                  // (PreallocateStep() continues after any padding that is left)
+    logCardFull = false;
     return;
   }
 
   if(path.indexOf('.') > 0){
     File file = SD.open((char *)path.c_str(), FILE_WRITE);
     if(file){
-      file.print("Started logging on: ");   
+      file.print("Started logging on: ");
       file.print(date);                                           // Write the date
       file.println(" ");
       // Write type (T = tracking), new track (1 = yes, 0 = no, same track), latitude, longitude, time (HH:MM:SS)
       // No. of satellites, elevation(m), speed(kmph), course
       // elapsed time (HH:MM:SS, so far), total distance (kilometers so far) description (summary) and color headers
-      file.println("type, new_track, latitude, longitude, time, satellites, elevation (m), speed (kmph), course, elapsed time, total distance (km), description, color");
+      file.println(LOG_HEADER);
+      logEndPos = logFileSize = file.position();
+      logCardFull = false;
       file.close();
     }
   }
   Serial.println("OK");
 }
 
+void recordWriteLatency(unsigned long us)                     // Add the write time of one fix to the latency histogram
+{
+  unsigned long ms = us / 1000;
+  int bucket = 0;
+  while (bucket < 7 && ms >= writeLatencyBounds[bucket]) bucket++;
+  writeLatencyHistogram[bucket]++;
+
+  if (PrintWriteLatency) {
+    Serial.print("Write latency (ms): " + String(us / 1000.0, 3) + "  Histogram:");
+    for (int i = 0; i < 8; i++) {
+      Serial.print((i < 7) ? " <" + String(writeLatencyBounds[i]) + ": " : " >=100: ");
+      Serial.print(writeLatencyHistogram[i]);
+    }
+    Serial.println();
+  }
+}
+
 void CreatePath()
 {
   String y, m, d;
   
   Serial.print("Chceking for a valid file name...");
-  do
+  while (true)
   {
     dateAndTime = ConvertUTC::localTime(gps.date.value(), gps.time.value(), TimeZone, DST, ConvertUTC::isLeapYear(gps.date.year()));
-    delay(500);
   
     y = String(gps.date.year());                               // Save the year, month and day
     m = String(dateAndTime[2]) + String(dateAndTime[3]);
     d = String(dateAndTime[4]) + String(dateAndTime[5]);
   
     fileName = y + m + d + ".txt";
+    if ((fileName != "20000000.txt") && (fileName != "20000001.txt")) break;   // If the name didn't change due to a fail in retrieving the date, wait
     
     Serial.println("The file name is invalid!");
     Serial.print("Waiting for data (3 seconds)");                   // Wait 3 seconds and restart
-    delay(1000); Serial.print('.');    
-    delay(1000); Serial.print('.');    
-    delay(1000); Serial.print('.');
-  } while ((fileName == "20000000.txt") || (fileName == "20000001.txt"));   // If the name didn't change due to a fail in retrieving the date
+    smartDelay(1000); Serial.print('.');    
+    smartDelay(1000); Serial.print('.');    
+    smartDelay(1000); Serial.print('.');
+  }
   Serial.println("OK");
 
   Serial.println("Folder name is: " + directoryName);
@@ -193,6 +303,7 @@ void CreatePath()
   SD.mkdir((char *)directoryName.c_str());                  // Make a new directory which the gps logs will be sotred in (If hasn't already existed)
     
   date = String(d) + '/' + String(m) + '/' + String(y);
+  fileDate = dateAndTime.substring(0, 6);
 }
 
 void createFile()
@@ -201,11 +312,21 @@ void createFile()
   CreatePath();
   
   Serial.print("Creating a new log file...");
+  if (option != 5) printDisplay("Preparing\nlog file...", 1, 0);
   CreateLogFile(filePath, date);
 
   isFileCreated = true;
 }
 
+void rolloverFile()                                           // A new day has started: close the log file of the previous day and start a new one
+{
+  Serial.println("New day. Closing " + filePath);
+  FinishLogFile();
+  newTrack = 1;                                               // The track summary and the start/end points are kept per file
+  trip.reset();                                               // and so are the trip statistics
+  createFile();
+}
+
 void gpsLoggerStart()
 {
   Serial.println("GPS Logger mode"); 
@@ -214,6 +335,13 @@ void gpsLoggerStart()
   Serial.println();
   Serial.println("Starting GPS serial...");
   gpsSerial.begin(GPSBaud);                                   // Set Software Serial Comm Speed to 9600
+
+  if (hasSD) {
+    Serial.println("Trimming the log files...");
+    trimLogFiles(directoryName, "");                          // Log files of earlier days that weren't closed (powered off) keep their padding
+    Serial.println("Loading geofence zones...");
+    geofence.load(geofencePath);
+  }
 }
 
 void readFromEEPROMMemory()
@@ -296,44 +424,52 @@ double distanceM(double currLat, double currLng, double prevLat, double prevLng)
     return distanceM;
 }
 
-void elapsedTime()
+void writeTrackSummary()                                      // Write the trip statistics as the description of the first track point (padded to summaryWidth)
 {
-  currHour = (int)dateAndTime[6] * 10 + (int)dateAndTime[7];
-  currMin = (int)dateAndTime[8] * 10 + (int)dateAndTime[9];
-  currSec = (int)dateAndTime[10] * 10 + (int)dateAndTime[11];
+  char timeStr[12];
   
-  if ((prevSec != -1) || (prevMin != -1) || (prevHour != -1))
-  {
-    if ((currHour - prevHour) < 0) totalTimeHours += 24 + currHour - prevHour;
-    else totalTimeHours += currHour - prevHour;
-    
-    if ((currMin - prevMin) < 0)
-    {
-      totalTimeMinutes += 60 + currMin - prevMin;
-      totalTimeHours--;
+  dataFile.print(", Total tracking time: <b>");
+  dataFile.print(elapsedTimeStr);                             // Total (accumulated) time
+  dataFile.print("</b><br>Total distance (km): <b>");
+  dataFile.print(trip.distance());                            // Total (accumulated) distance in km
+  dataFile.print("</b><br>Moving time: <b>");
+  TripStats::formatTime(trip.movingTime(), timeStr);
+  dataFile.print(timeStr);
+  dataFile.print("</b><br>Stopped time: <b>");
+  TripStats::formatTime(trip.stoppedTime(), timeStr);
+  dataFile.print(timeStr);
+  dataFile.print("</b><br>Average moving speed (kmph): <b>");
+  dataFile.print(trip.averageSpeed());
+  dataFile.print("</b><br>Max speed (kmph): <b>");
+  dataFile.print(trip.maxSpeed());
+  dataFile.print("</b><br>Elevation gain/loss (m): <b>+");
+  dataFile.print((int)trip.elevationGain());
+  dataFile.print("/-");
+  dataFile.print((int)trip.elevationLoss());
+  if (trip.splitCount() > 0) {                                // Per-km splits (min:sec per km). No commas - the description is a single CSV field
+    dataFile.print("</b><br>Km splits: <b>");
+    for (int km = 1; km <= trip.splitCount() && km <= MAX_SPLITS; km++) {
+      TripStats::formatSplit(trip.split(km), timeStr);
+      dataFile.print(timeStr);
+      dataFile.print(' ');
     }
-    else totalTimeMinutes += currMin - prevMin;
-    
-    if ((currSec - prevSec) < 0) 
-    {
-      totalTime += 60 + currSec - prevSec;
-      totalTimeMinutes--;
-    }
-    else totalTime += currSec - prevSec;
+    if (trip.splitCount() > MAX_SPLITS) dataFile.print("... ");
+    dataFile.print("</b><br>Last/fastest split: <b>");
+    TripStats::formatSplit(trip.lastSplit(), timeStr);
+    dataFile.print(timeStr);
+    dataFile.print('/');
+    TripStats::formatSplit(trip.fastestSplit(), timeStr);
+    dataFile.print(timeStr);
   }
-  
-  prevHour = currHour;
-  prevMin = currMin;
-  prevSec = currSec;
-  
-  totalTimeSeconds = totalTime % 60;
-  totalTimeMinutes = (totalTime / 60) % 60;
-  totalTimeHours = (totalTime / 60) / 60;
-  
-  if (totalTimeSeconds < 10) totalTimeSecondsStr = '0' + String(totalTimeSeconds);
-  else totalTimeSecondsStr = String(totalTimeSeconds);
-  if (totalTimeMinutes < 10) totalTimeMinutesStr = '0' + String(totalTimeMinutes);
-  else totalTimeMinutesStr = String(totalTimeMinutes);
+  dataFile.print("</b>");
+
+  char padding[summaryWidth];                                 // Pad, so a longer summary never runs over the next line
+  int n = (int)(pos + summaryWidth) - (int)dataFile.position();
+  if (n > 0) {
+    memset(padding, ' ', n);
+    dataFile.write((uint8_t *)padding, n);
+  }
+  dataFile.println();
 }
 
 void drawClockIcon(int x, int y)
@@ -662,12 +798,12 @@ void loop()
     wifiStatus = WifiWebServer.start();
     printDisplay(wifiStatus, 1, 0);*/
     option++;
-    if (option == 4)
+    if (option == 5)
     {
       display.clearDisplay();
       display.display();
     }
-    if (option > 4) option = 0;
+    if (option > 5) option = 0;
   }
   else {
     mode = 0;
@@ -729,7 +865,7 @@ void loop()
       {
         if (batteryStatus(batteryPin) < currentBatteryPercent)
           currentBatteryPercent = batteryStatus(batteryPin);
-        if (option != 4) {
+        if (option != 5) {
           if (analogRead(batteryPin) < 10) printDisplay("  " + h + ":" + m + ":" + s, 1, 0);
           else printDisplay("  " + h + ":" + m + ":" + s + "   " + String(currentBatteryPercent) + '%' + ' ' /*+ char(14)sound enabled/disabled + char(8) sd card inserted/or not*/, 1, 0);  /// Status bar on display
           drawClockIcon(0, 0);
@@ -766,17 +902,31 @@ void loop()
         }
         case 3:
         {
-          elapsedTime();
           display.print("Total time: ");
-          display.print(totalTimeHours);             // Total (accumulated) hours time
-          display.print(":");
-          display.print(totalTimeMinutesStr);           // Total (accumulated) minutes time
-          display.print(":");  
-          display.println(totalTimeSecondsStr);          // Total (accumulated) seconds time        
+          display.println(elapsedTimeStr);           // Total (accumulated) time
           display.print("Kilometers: ");
-          display.println(totalDistance_km);
+          display.println(trip.distance());
+          break;
         }
         case 4:
+        {
+          char movingTimeStr[12];
+          TripStats::formatTime(trip.movingTime(), movingTimeStr);
+          display.print("Mv ");
+          display.print(movingTimeStr);              // Moving time
+          display.print(" +");
+          display.print((int)trip.elevationGain());  // Elevation gain
+          display.print("/-");
+          display.print((int)trip.elevationLoss());  // Elevation loss
+          display.println("m");
+          display.print("Avg ");
+          display.print(trip.averageSpeed(), 1);     // Average moving speed
+          display.print(" Max ");
+          display.print(trip.maxSpeed(), 1);         // Max speed
+          display.println("kmph");
+          break;
+        }
+        case 5:
         {
           break;
         }
@@ -790,9 +940,17 @@ void loop()
       if (gps.location.isValid()) {                              // Check if the gps location (coordinates) is ready
         if (gps.location.age() < 1500) {                          // If this returns a value greater than 1500 or so, it may be a sign of a problem like a lost fix.
           if ((millis() - start) > gpsSampleTime) {                    // Make sure a time passed that is over gps sample time to display (Save coordinates every GPS sample time)
-            if (!isFileCreated) createFile();
+            if (!isFileCreated) {                                       // Before logging starts: create the file and preallocate all of it
+              createFile();
+              if (option != 5) printDisplay("Preallocating\nlog file...", 1, 0);
+              logAllocated = logEndPos + logPreallocationSize();
+              PreallocateStep(ULONG_MAX);
+            }
+            unsigned long writeStart = micros();                        // The latency of a fix includes creating the file of a new day
+            if (gps.date.isValid() && dateAndTime.substring(0, 6) != fileDate) rolloverFile();
             dataFile = SD.open((char *)filePath.c_str(), FILE_WRITE);    // Write to file
             if (dataFile) {                                              // If the file is opened it's ready to be written
+              dataFile.seek(logEndPos);                                  // Write over the preallocated padding (no cluster allocation)
               // Calculate the local time according to the UTC time received from the GPS module
               dateAndTime = ConvertUTC::localTime(gps.date.value(), gps.time.value(), TimeZone, DST, ConvertUTC::isLeapYear(gps.date.year()));
               h = String(dateAndTime[6]) + String(dateAndTime[7]);
@@ -808,21 +966,21 @@ void loop()
               prevLat = currLat;
               prevLng = currLng;
 
-              totalDistance_km += distance_km;
-
-              elapsedTime();
-
               int satellitesValue = gps.satellites.value();
               float altitudeValue = gps.altitude.meters();
               float speedValue = gps.speed.kmph();
               float courseValue= gps.course.deg();
+
+              unsigned long epoch = ConvertUTC::epochTime(gps.date.year(), gps.date.month(), gps.date.day(), gps.time.hour(), gps.time.minute(), gps.time.second());
+              trip.update(epoch, distance_km, speedValue, altitudeValue);
+              TripStats::formatTime(trip.elapsedTime(), elapsedTimeStr);
                 
               Serial.print("Data is valid! Printing to file...");     // Print the valid data to the data file (location, time and others)
 
               // Starting point of the track (waypoint)
               if (newTrack == 1)
               {
-                dataFile.print('W');
+                dataFile.print(LOG_WAYPOINT);
                 dataFile.print(",, ");
                 dataFile.print(currLat, 6);
                 dataFile.print(", ");
@@ -841,7 +999,7 @@ void loop()
               }
               //
               
-              dataFile.print('T');                        // Track point (W - Waypoint, T - Trackpoint, R - Routepoint)
+              dataFile.print(LOG_TRACKPOINT);             // Track point (W - Waypoint, T - Trackpoint, R - Routepoint)
               dataFile.print(", ");
               dataFile.print(newTrack);                   // New track or the same (old) track
               dataFile.print(", ");
@@ -863,30 +1021,46 @@ void loop()
               dataFile.print(", ");
               dataFile.print(courseValue);                // Course/Heading
               dataFile.print(", ");
-              dataFile.print(totalTimeHours);             // Total (accumulated) hours time
-              dataFile.print(":");
-              dataFile.print(totalTimeMinutesStr);        // Total (accumulated) minutes time
-              dataFile.print(":");  
-              dataFile.print(totalTimeSecondsStr);        // Total (accumulated) seconds time 
+              dataFile.print(elapsedTimeStr);             // Total (accumulated) time
               dataFile.print(", ");
-              dataFile.println(totalDistance_km);         // Total (accumulated) distance in km
+              dataFile.println(trip.distance());          // Total (accumulated) distance in km
+              logEndPos = dataFile.position();
 
               // Description data in the file
               if (newTrack == 1) pos = dataFile.position() - 2;
               dataFile.seek(pos);
-              dataFile.print(", Total tracking time: <b>");
-              dataFile.print(totalTimeHours);             // Total (accumulated) hours time
-              dataFile.print(":");
-              dataFile.print(totalTimeMinutesStr);        // Total (accumulated) minutes time
-              dataFile.print(":");  
-              dataFile.print(totalTimeSecondsStr);        // Total (accumulated) seconds time 
-              dataFile.print("</b><br>Total distance (km): <b>");
-              dataFile.print(totalDistance_km);           // Total (accumulated) distance in km
-              dataFile.println("</b>");
+              writeTrackSummary();
+              if (dataFile.position() > logEndPos) logEndPos = dataFile.position();
+
+              // Geofence events (entering/leaving a zone, arriving at/leaving a depot) as waypoints
+              int events = geofence.update(currLat, currLng);
+              if (events > 0) {
+                dataFile.seek(logEndPos);
+                for (int i = 0; i < events; i++) {
+                  dataFile.print(LOG_WAYPOINT);
+                  dataFile.print(",, ");
+                  dataFile.print(currLat, 6);
+                  dataFile.print(", ");
+                  dataFile.print(currLng, 6);
+                  dataFile.print(", ");
+                  dataFile.print(h);                      // Local time
+                  dataFile.print(":");
+                  dataFile.print(m);                      // Minutes
+                  dataFile.print(":");
+                  dataFile.print(s);                      // Seconds
+                  dataFile.print(",,,,,,, ");
+                  if (geofence.eventIsDepot(i)) dataFile.print(geofence.eventEntered(i) ? "Arrived at " : "Left ");
+                  else dataFile.print(geofence.eventEntered(i) ? "Entered " : "Exited ");
+                  dataFile.print(geofence.eventName(i));
+                  dataFile.println(geofence.eventIsDepot(i) ? ", orange" : ", blue");
+                  Serial.println(String(geofence.eventEntered(i) ? "Entered: " : "Left: ") + geofence.eventName(i));
+                }
+                logEndPos = dataFile.position();
+              }
 
               // Ending point of the track (waypoint)
               dataFile.seek(EndPointPos);
-              dataFile.print('W');
+              dataFile.print(LOG_WAYPOINT);
               dataFile.print(",, ");
               dataFile.print(currLat, 6);
               dataFile.print(", ");
@@ -902,17 +1076,19 @@ void loop()
               //
               
               dataFile.close();
+              if (logEndPos > logFileSize) logFileSize = logEndPos;   // Logged past the padding (it is padded again by smartDelay())
               Serial.println("Done!");
+              recordWriteLatency(micros() - writeStart);
 
               newTrack = 0;
   
-              if (option != 4) {
+              if (option != 5) {
                 display.print("Saved to file!");
                 display.display();
               }          
             } else {
               Serial.println("Error opening " + filePath);                  // If the file isn't open, pop up an error
-               if (option != 4) {
+               if (option != 5) {
                 display.print("Error opening file!");
                 display.display();
                }
@@ -922,7 +1098,7 @@ void loop()
         } else {
           Serial.println("Lost GPS Signal!");                    // There is a lost fix (data hasn't changed), so print a message
           if ((millis() - start) > gpsSampleTime) { 
-            if (option != 4) {
+            if (option != 5) {
               display.print("Lost GPS Signal!");
               display.display();
             }
@@ -932,7 +1108,7 @@ void loop()
       } else {
         Serial.println("Invalid data! Waiting for a valid data...");  // Invalid data is blank cordinates (00.000000)
         if ((millis() - start) > gpsSampleTime) { 
-          if (option != 4) {
+          if (option != 5) {
             display.print("Invailid data!");
             display.display();
             }
@@ -0,0 +1,286 @@
+/*
+  geofencebench - host benchmark of the firmware geofence (Geofence.cpp, compiled with the stand-ins of tools/host).
+  Not part of the firmware.
+
+  Generates a zones file (polygons and depots around the track, one large zone over the whole area and one far away
+  depot), replays a track through Geofence::update() and through a plain test of every zone, and prints the time
+  per fix of both, the events and the memory load() allocated.
+
+  Usage: geofencebench [-z zones] [-n fixes] [-k zones.txt] [log files...]
+         geofencebench --selftest
+    -z zones   zones to generate (default 1000)
+    -n fixes   fixes of the generated track, when no log files are given (default 200000)
+    -k path    where to write the zones file (default /tmp/geofencebench-zones.txt)
+    log files  replay the track points (T lines) of these logger files instead of a generated track
+    --selftest check the zones file parsing (comments, headers, junk and broken lines). Build it with
+               `make selftest` (AddressSanitizer), so a write past the arrays load() allocated fails it
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Geofence.h"
+#include "../../LogFormat.h"
+
+static const double metersPerDegree = 111320.0;
+
+struct Point {
+  float lat, lng;
+};
+
+struct TestZone {                                             // The generated zones, for the plain test
+  bool depot;
+  std::vector<Point> vertices;                                // Depot - its center
+  float radius_m;
+};
+
+static bool contains(const TestZone &zone, float lat, float lng) {
+  if (zone.depot) {
+    float dy = (lat - zone.vertices[0].lat) * metersPerDegree;
+    float dx = (lng - zone.vertices[0].lng) * metersPerDegree * cos(radians(lat));
+    return dx * dx + dy * dy <= zone.radius_m * zone.radius_m;
+  }
+  bool in = false;
+  const std::vector<Point> &v = zone.vertices;
+  for (size_t i = 0, j = v.size() - 1; i < v.size(); j = i++)
+    if (((v[i].lat > lat) != (v[j].lat > lat)) &&
+        (lng < (v[j].lng - v[i].lng) * (lat - v[i].lat) / (v[j].lat - v[i].lat) + v[i].lng))
+      in = !in;
+  return in;
+}
+
+static bool readTrack(const char *path, std::vector<Point> &track) {
+  FILE *file = fopen(path, "rb");
+  if (!file) {
+    perror(path);
+    return false;
+  }
+  char line[1024];
+  while (fgets(line, sizeof(line), file)) {
+    if (line[0] != LOG_TRACKPOINT) continue;
+    double values[LOG_FIELDS] = {0};
+    char *field = line;
+    for (int i = 0; i < LOG_FIELDS && field; i++) {
+      values[i] = atof(field);
+      field = strchr(field, ',');
+      if (field) field++;
+    }
+    if (values[LOG_FIELD_LATITUDE] != 0 || values[LOG_FIELD_LONGITUDE] != 0)
+      track.push_back({(float)values[LOG_FIELD_LATITUDE], (float)values[LOG_FIELD_LONGITUDE]});
+  }
+  fclose(file);
+  return true;
+}
+
+static bool check(const char *what, long value, long expected) {
+  printf("%s: %ld%s\n", what, value, value == expected ? "" : (" - FAILED, expected " + std::to_string(expected)).c_str());
+  return value == expected;
+}
+
+static bool selftest() {
+  const char *path = "/tmp/geofencebench-selftest.txt";
+  FILE *file = fopen(path, "w");
+  if (!file) {
+    perror(path);
+    return false;
+  }
+  fprintf(file,
+          "type, name, lat, lng, lat, lng, lat, lng\n"             // A CSV header
+          "# Z, commented out, 1, 1, 1, 2, 2, 2\n"
+          "\n"
+          "x, junk, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9\n"
+          "Z, square, 32.0, 34.8, 32.0, 34.81, 32.01, 34.81, 32.01, 34.8\n"
+          "x, more junk, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9\n"
+          "D, depot with a long name that was cut before, 32.003, 34.807, 100\n"
+          "Z, odd values, 32.0, 34.8, 32.0, 34.81, 32.01, 34.81, 32.01\n"   // Last vertex has no longitude
+          "Z, two vertices, 32.0, 34.8, 32.0, 34.81\n"
+          "D, no radius, 32.0, 34.8\n"
+          "Z, name only\n"
+          "Z\n"
+          "D,\n"
+          "x, trailing junk, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9\n");
+  fclose(file);
+
+  Geofence geofence;
+  bool ok = check("zones loaded", geofence.load(path), 3);
+  int events = geofence.update(32.003, 34.807);              // Inside the square, the odd one (a triangle) and the depot
+  ok &= check("events at the depot", events, 3);
+  bool named = false;
+  for (int i = 0; i < events; i++)
+    named |= strcmp(geofence.eventName(i), "depot with a long name that was cut before") == 0;
+  ok &= check("depot name kept", named, 1);
+  ok &= check("events far away", geofence.update(33, 35), 3);
+
+  // 20 nested squares (the position is inside of all of them at the center) among small zones, so the squares are on
+  // several grid cells. Walking across them must enter and leave each square once, whatever the cells
+  file = fopen(path, "w");
+  for (int k = 1; k <= 20; k++) {
+    double r = 0.0002 * k;
+    fprintf(file, "Z, square %d, %.6f, %.6f, %.6f, %.6f, %.6f, %.6f, %.6f, %.6f\n", k,
+            32.1 - r, 34.9 - r, 32.1 - r, 34.9 + r, 32.1 + r, 34.9 + r, 32.1 + r, 34.9 - r);
+  }
+  for (int k = 0; k < 100; k++) fprintf(file, "D, small %d, %.6f, 35.0, 10\n", k, 32.0 + k * 0.001);
+  fclose(file);
+  ok &= check("nested zones loaded", geofence.load(path), 120);
+  long entered = 0, left = 0;
+  for (int step = 0; step <= 200; step++) {
+    int events = geofence.update(32.1 - 0.005 + step * 0.00005, 34.9 + 0.00001);
+    for (int i = 0; i < events; i++) (geofence.eventEntered(i) ? entered : left)++;
+  }
+  ok &= check("nested zones entered", entered, 20);
+  ok &= check("nested zones left", left, 20);
+
+  // Jumping into all of them at once: MAX_ZONE_EVENTS now, the rest on the next fix
+  ok &= check("jump in", geofence.update(32.1, 34.9), MAX_ZONE_EVENTS);
+  ok &= check("jump in, next fix", geofence.update(32.1, 34.9), 20 - MAX_ZONE_EVENTS);
+  ok &= check("same position", geofence.update(32.1, 34.9), 0);
+  ok &= check("jump out", geofence.update(33, 35), MAX_ZONE_EVENTS);
+  ok &= check("jump out, next fix", geofence.update(33, 35), 20 - MAX_ZONE_EVENTS);
+  remove(path);
+  return ok;
+}
+
+int main(int argc, char **argv) {
+  if (argc == 2 && std::string(argv[1]) == "--selftest") return selftest() ? 0 : 1;
+
+  int zonesCount = 1000;
+  long fixesCount = 200000;
+  const char *zonesPath = "/tmp/geofencebench-zones.txt";
+  std::vector<Point> track;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "-z" && i + 1 < argc) zonesCount = atoi(argv[++i]);
+    else if (arg == "-n" && i + 1 < argc) fixesCount = atol(argv[++i]);
+    else if (arg == "-k" && i + 1 < argc) zonesPath = argv[++i];
+    else if (!readTrack(argv[i], track)) return 1;
+  }
+
+  std::mt19937 random(1);
+  std::uniform_real_distribution<double> unit(0, 1);
+
+  // Track: the replayed points, or a random walk of 10 m steps (1 Hz at 36 km/h)
+  if (track.empty()) {
+    double lat = 32.0, lng = 34.8, course = 0;
+    for (long i = 0; i < fixesCount; i++) {
+      course += (unit(random) - 0.5) * 0.5;
+      lat += 10 * cos(course) / metersPerDegree;
+      lng += 10 * sin(course) / metersPerDegree / cos(radians(lat));
+      track.push_back({(float)lat, (float)lng});
+    }
+  }
+  float minLat = track[0].lat, maxLat = track[0].lat, minLng = track[0].lng, maxLng = track[0].lng;
+  for (const Point &p : track) {
+    minLat = min(minLat, p.lat);
+    maxLat = max(maxLat, p.lat);
+    minLng = min(minLng, p.lng);
+    maxLng = max(maxLng, p.lng);
+  }
+
+  // Zones: half polygons (50-400 m), half depots (30-300 m), on the track or near it
+  std::vector<TestZone> zones;
+  FILE *zonesFile = fopen(zonesPath, "w");
+  if (!zonesFile) {
+    perror(zonesPath);
+    return 1;
+  }
+  fprintf(zonesFile, "# geofencebench: %d zones\n", zonesCount);
+  for (int z = 0; z < zonesCount; z++) {
+    TestZone zone;
+    Point center = track[random() % track.size()];
+    if (z % 4 == 3) {                                         // Near the track, not on it
+      center.lat += (unit(random) - 0.5) * 0.02;
+      center.lng += (unit(random) - 0.5) * 0.02;
+    }
+    zone.depot = z % 2;
+    if (zone.depot) {
+      zone.radius_m = 30 + unit(random) * 270;
+      zone.vertices.push_back(center);
+      fprintf(zonesFile, "D, depot %d, %.6f, %.6f, %.0f\n", z, center.lat, center.lng, zone.radius_m);
+      zone.radius_m = (float)(int)(zone.radius_m + 0.5);
+    }
+    else {
+      zone.radius_m = 0;
+      int vertices = 3 + random() % 6;
+      double size = (50 + unit(random) * 350) / metersPerDegree;
+      fprintf(zonesFile, "Z, zone %d", z);
+      for (int v = 0; v < vertices; v++) {
+        double angle = 2 * M_PI * v / vertices, r = size * (0.5 + unit(random) * 0.5) / 2;
+        Point p = {(float)(center.lat + r * cos(angle)), (float)(center.lng + r * sin(angle) / cos(radians(center.lat)))};
+        fprintf(zonesFile, ", %.6f, %.6f", p.lat, p.lng);
+      }
+      fprintf(zonesFile, "\n");
+    }
+    zones.push_back(zone);
+  }
+  fclose(zonesFile);
+
+  // Read the polygons back as written (6 decimals), so both tests see the same vertices
+  {
+    FILE *file = fopen(zonesPath, "r");
+    char line[1024];
+    int z = 0;
+    while (fgets(line, sizeof(line), file)) {
+      if (line[0] != 'Z' && line[0] != 'D') continue;
+      char *field = strchr(strchr(line, ',') + 1, ',');
+      std::vector<float> values;
+      while (field) {
+        values.push_back(atof(field + 1));
+        field = strchr(field + 1, ',');
+      }
+      zones[z].vertices.clear();
+      for (size_t i = 0; i + 1 < values.size(); i += 2) zones[z].vertices.push_back({values[i], values[i + 1]});
+      z++;
+    }
+    fclose(file);
+  }
+
+  // One zone over the whole area (a city limit) and one depot far away (stretches the bounds of all the zones)
+  zonesFile = fopen(zonesPath, "a");
+  fprintf(zonesFile, "Z, area, %.6f, %.6f, %.6f, %.6f, %.6f, %.6f, %.6f, %.6f\n",
+          minLat - 0.01, minLng - 0.01, minLat - 0.01, maxLng + 0.01, maxLat + 0.01, maxLng + 0.01, maxLat + 0.01, minLng - 0.01);
+  fprintf(zonesFile, "D, far depot, 40.689247, -74.044502, 200\n");
+  fclose(zonesFile);
+  {
+    TestZone area = {false, {}, 0};
+    float lat0 = minLat - 0.01, lat1 = maxLat + 0.01, lng0 = minLng - 0.01, lng1 = maxLng + 0.01;
+    char buf[4][32];
+    float v[8] = {lat0, lng0, lat0, lng1, lat1, lng1, lat1, lng0};
+    for (int i = 0; i < 8; i += 2) {
+      snprintf(buf[0], 32, "%.6f", v[i]);
+      snprintf(buf[1], 32, "%.6f", v[i + 1]);
+      area.vertices.push_back({(float)atof(buf[0]), (float)atof(buf[1])});
+    }
+    zones.push_back(area);
+    zones.push_back({true, {{40.689247f, -74.044502f}}, 200});
+  }
+
+  Geofence geofence;
+  if (geofence.load(zonesPath) == 0) return 1;
+
+  typedef std::chrono::steady_clock Clock;
+  Clock::time_point start = Clock::now();
+  long events = 0;
+  for (const Point &p : track) events += geofence.update(p.lat, p.lng);
+  double indexedNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / track.size();
+
+  start = Clock::now();
+  long plainEvents = 0;
+  std::vector<char> inside(zones.size(), 0);
+  for (const Point &p : track)
+    for (size_t z = 0; z < zones.size(); z++) {
+      char now = contains(zones[z], p.lat, p.lng);
+      if (now != inside[z]) plainEvents++;
+      inside[z] = now;
+    }
+  double plainNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / track.size();
+
+  printf("zones: %d (+ area, far depot), fixes: %zu\n", zonesCount, track.size());
+  printf("memory: %lu bytes (%.1f per zone)\n", geofence.memoryUsed(), (double)geofence.memoryUsed() / geofence.zoneCount());
+  printf("indexed: %.0f ns/fix, %ld events\n", indexedNs, events);
+  printf("every zone: %.0f ns/fix, %ld events\n", plainNs, plainEvents);
+  if (events != plainEvents) printf("MISMATCH: %ld events\n", events - plainEvents);
+  return events != plainEvents;
+}
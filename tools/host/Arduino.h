@@ -0,0 +1,64 @@
+/*
+  Arduino.h - host stand-in for the parts of the Arduino core used by the firmware modules that the host tools
+  compile (tools/geofencebench, tools/previewreplay). Not part of the firmware.
+*/
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+using std::max;
+using std::min;
+
+#define radians(deg) ((deg) * M_PI / 180.0)
+
+inline void yield() {}
+
+class String
+{
+  public:
+    String() {}
+    String(const char *c) : s(c) {}
+    String(const std::string &x) : s(x) {}
+    String(char c) : s(1, c) {}
+    String(int v) : s(std::to_string(v)) {}
+    String(long v) : s(std::to_string(v)) {}
+    String(unsigned int v) : s(std::to_string(v)) {}
+    String(unsigned long v) : s(std::to_string(v)) {}
+    String(float v, int decimals = 2) { char buf[32]; snprintf(buf, sizeof(buf), "%.*f", decimals, v); s = buf; }
+    const char *c_str() const { return s.c_str(); }
+    unsigned int length() const { return s.length(); }
+    char operator[](unsigned int i) const { return i < s.length() ? s[i] : 0; }
+    bool operator==(const String &o) const { return s == o.s; }
+    bool operator!=(const String &o) const { return s != o.s; }
+    String &operator+=(const String &o) { s += o.s; return *this; }
+    int indexOf(char c, unsigned int from = 0) const { size_t i = s.find(c, from); return i == std::string::npos ? -1 : (int)i; }
+    String substring(unsigned int from, unsigned int to) const { return from >= to || from >= s.length() ? String() : String(s.substr(from, to - from)); }
+    float toFloat() const { return atof(s.c_str()); }
+    void trim() {
+      size_t a = s.find_first_not_of(" \t\r\n");
+      size_t b = s.find_last_not_of(" \t\r\n");
+      s = (a == std::string::npos) ? std::string() : s.substr(a, b - a + 1);
+    }
+    std::string s;
+};
+
+inline String operator+(const String &a, const String &b) { return a.s + b.s; }
+inline String operator+(const char *a, const String &b) { return std::string(a) + b.s; }
+inline String operator+(const String &a, const char *b) { return a.s + b; }
+
+class HostSerial
+{
+  public:
+    void print(const String &x) { fputs(x.c_str(), stderr); }
+    void println(const String &x) { fprintf(stderr, "%s\n", x.c_str()); }
+};
+inline HostSerial Serial;
+
+#endif
@@ -0,0 +1,166 @@
+/*
+  SD.h - host stand-in for the SD library: files of the SD card are files of the host file system.
+  Not part of the firmware.
+
+  Optionally it simulates the time the card takes (tools/sdlatency). Like the SD library (SdFat), an open file caches
+  one block: a partial block write reads the block (if it has data) and writes it back when another block is
+  needed or the file is closed. A write past the clusters of a file allocates clusters. The costs are set in
+  hostCard and the simulated time is added to hostCard.clock_ms. All the costs are 0 by default (no simulation).
+*/
+#ifndef SD_h
+#define SD_h
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Arduino.h"
+
+#define FILE_READ "rb"
+#define FILE_WRITE "r+b"
+
+struct HostCard
+{
+  unsigned long blockSize = 512;
+  unsigned long clusterSize = 32768;
+  double open_ms = 0;                                         // Directory search
+  double close_ms = 0;                                        // Directory entry and FAT update of a changed file
+  double blockRead_ms = 0;
+  double blockWrite_ms = 0;
+  double clusterAllocate_ms = 0;                              // Free cluster search, FAT update, and the card's own allocation
+  double clock_ms = 0;                                        // Simulated time spent in the card
+  unsigned long clustersAllocated = 0;
+};
+inline HostCard hostCard;
+
+class File
+{
+  public:
+    operator bool() const { return f != NULL || dir != NULL; }
+    int available() { long pos = ftell(f); return pos < (long)size() ? 1 : 0; }
+    unsigned long size() { struct stat st; fstat(fileno(f), &st); return st.st_size; }
+    unsigned long position() { return ftell(f); }
+    bool seek(unsigned long pos) { return fseek(f, pos, SEEK_SET) == 0; }
+    int read() {
+      uint8_t c;
+      return read(&c, 1) == 1 ? c : -1;
+    }
+    int read(void *buf, size_t n) {
+      unsigned long pos = position();
+      int count = fread(buf, 1, n, f);
+      for (unsigned long b = pos / hostCard.blockSize; count > 0 && b <= (pos + count - 1) / hostCard.blockSize; b++) useBlock(b, true);
+      return count;
+    }
+    size_t write(const uint8_t *buf, size_t n) {
+      if (n == 0) return 0;
+      unsigned long pos = position(), oldSize = size();
+      size_t count = fwrite(buf, 1, n, f);
+      fflush(f);
+      for (unsigned long b = pos / hostCard.blockSize; b <= (pos + count - 1) / hostCard.blockSize; b++) {
+        unsigned long start = b * hostCard.blockSize;
+        if (pos <= start && pos + count >= start + hostCard.blockSize) {   // Whole block: written directly
+          if (b == cachedBlock) cachedBlock = NO_BLOCK, dirty = false;
+          hostCard.clock_ms += hostCard.blockWrite_ms;
+        }
+        else {                                                // Partial block: through the cache
+          useBlock(b, start < oldSize);
+          dirty = true;
+        }
+      }
+      unsigned long clusters = (size() + hostCard.clusterSize - 1) / hostCard.clusterSize;
+      if (clusters > fileClusters) {
+        hostCard.clock_ms += (clusters - fileClusters) * hostCard.clusterAllocate_ms;
+        hostCard.clustersAllocated += clusters - fileClusters;
+        fileClusters = clusters;
+      }
+      changed = true;
+      return count;
+    }
+    size_t write(uint8_t c) { return write(&c, 1); }
+    bool truncate(unsigned long n) {
+      fflush(f);
+      fileClusters = (n + hostCard.clusterSize - 1) / hostCard.clusterSize;
+      if (cachedBlock != NO_BLOCK && cachedBlock * hostCard.blockSize >= n) cachedBlock = NO_BLOCK, dirty = false;
+      changed = true;
+      return ftruncate(fileno(f), n) == 0;
+    }
+    String readStringUntil(char end) {
+      std::string line;
+      int c;
+      while ((c = read()) >= 0 && c != end) line += (char)c;
+      return line;
+    }
+    void close() {
+      if (f) {
+        if (dirty) hostCard.clock_ms += hostCard.blockWrite_ms;
+        if (changed) hostCard.clock_ms += hostCard.close_ms;
+        fclose(f);
+      }
+      if (dir) closedir(dir);
+      f = NULL;
+      dir = NULL;
+    }
+    bool isDirectory() { return dir != NULL || entryIsDirectory; }
+    void rewindDirectory() { if (dir) rewinddir(dir); }
+    File openNextFile() {
+      struct dirent *entry;
+      while (dir && (entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+        File file;
+        file.path = path + "/" + entry->d_name;
+        file.entryName = entry->d_name;
+        struct stat st;
+        file.entryIsDirectory = stat(file.path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+        file.f = file.entryIsDirectory ? NULL : fopen(file.path.c_str(), FILE_READ);
+        return file;
+      }
+      return File();
+    }
+    const char *name() { return entryName.c_str(); }
+
+    FILE *f = NULL;
+    DIR *dir = NULL;
+    std::string path, entryName;
+    bool entryIsDirectory = false;
+    unsigned long fileClusters = 0;
+
+  private:
+    static const unsigned long NO_BLOCK = ~0UL;
+    unsigned long cachedBlock = NO_BLOCK;
+    bool dirty = false, changed = false;
+
+    void useBlock(unsigned long block, bool hasData) {        // Bring a block to the cache
+      if (block == cachedBlock) return;
+      if (dirty) hostCard.clock_ms += hostCard.blockWrite_ms;
+      if (hasData) hostCard.clock_ms += hostCard.blockRead_ms;
+      cachedBlock = block;
+      dirty = false;
+    }
+};
+
+class HostSD
+{
+  public:
+    File open(const char *path, const char *mode = FILE_READ) {
+      File file;
+      file.path = path;
+      const char *name = strrchr(path, '/');
+      file.entryName = name ? name + 1 : path;
+      struct stat st;
+      if (stat(path, &st) == 0 && S_ISDIR(st.st_mode)) file.dir = opendir(path);
+      else {
+        file.f = fopen(path, mode);
+        if (!file.f && strcmp(mode, FILE_WRITE) == 0) file.f = fopen(path, "w+b");   // FILE_WRITE creates the file
+        if (!file.f) return File();
+        file.fileClusters = (file.size() + hostCard.clusterSize - 1) / hostCard.clusterSize;
+      }
+      hostCard.clock_ms += hostCard.open_ms;
+      return file;
+    }
+    bool exists(const char *path) { struct stat st; return stat(path, &st) == 0; }
+    bool mkdir(const char *path) { return ::mkdir(path, 0755) == 0; }
+    bool remove(const char *path) { return ::remove(path) == 0; }
+};
+inline HostSD SD;
+
+#endif
@@ -0,0 +1,608 @@
+/*
+  logingest.cpp - Fleet ingestion tool for the GPS logger files (Linux).
+
+  Reads the daily log files (gpslog/YYYYMMDD.txt) of many logger units, parses the track points and
+  waypoints and writes per-unit/per-day summaries (CSV) and a columnar binary file of all the track points.
+  Files are memory mapped and parsed in parallel on a work-stealing thread pool. The preallocated padding at the
+  end of a file is skipped without reading it. The track points are kept in memory only for the columnar output (-o).
+
+  The unit of a file is the name of the directory that contains its gpslog directory, for example:
+  fleet/unit07/gpslog/20180521.txt -> unit "unit07", day 20180521
+
+  Columnar output (little endian):
+  "GPSCOL01", uint64 rows, uint32 units, units x (uint16 length, name),
+  then the columns, one after the other, rows values each:
+  unit (uint16, index in the units list), day (uint32, YYYYMMDD), time (uint32, seconds of the local day),
+  latitude (float64), longitude (float64), elevation (float32, m), speed (float32, kmph), course (float32, deg),
+  satellites (uint8), new_track (uint8)
+*/
+
+#include <algorithm>
+#include <cstdarg>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../../LogFormat.h"
+
+namespace fs = std::filesystem;
+
+// Work-stealing thread pool. Each worker takes tasks from the front of its own queue and, when it is empty,
+// steals from the back of the other workers' queues. Tasks are all submitted before run()
+class WorkStealingPool
+{
+  public:
+    explicit WorkStealingPool(unsigned threads) {
+      for (unsigned i = 0; i < threads; i++) queues.emplace_back(new Queue);
+    }
+
+    void submit(std::function<void()> task) {
+      Queue &q = *queues[next++ % queues.size()];
+      std::lock_guard<std::mutex> guard(q.lock);
+      q.tasks.push_back(std::move(task));
+    }
+
+    void run() {
+      std::vector<std::thread> workers;
+      for (unsigned i = 0; i < queues.size(); i++)
+        workers.emplace_back([this, i]() {
+          std::function<void()> task;
+          while (pop(i, task)) task();
+        });
+      for (auto &worker : workers) worker.join();
+    }
+
+  private:
+    struct Queue {
+      std::mutex lock;
+      std::deque<std::function<void()>> tasks;
+    };
+
+    bool pop(unsigned self, std::function<void()> &task) {
+      for (unsigned i = 0; i < queues.size(); i++) {
+        Queue &q = *queues[(self + i) % queues.size()];
+        std::lock_guard<std::mutex> guard(q.lock);
+        if (q.tasks.empty()) continue;
+        if (i == 0) {                                         // Own queue
+          task = std::move(q.tasks.front());
+          q.tasks.pop_front();
+        } else {                                              // Steal
+          task = std::move(q.tasks.back());
+          q.tasks.pop_back();
+        }
+        return true;
+      }
+      return false;                                           // No new tasks are submitted while running, so all done
+    }
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    unsigned next = 0;
+};
+
+struct Summary
+{
+  uint64_t points = 0, waypoints = 0, tracks = 0;
+  uint32_t firstTime = UINT32_MAX, lastTime = 0;              // Seconds of the local day
+  double distance_km = 0;
+  float maxSpeed = 0;
+  float minElevation = INFINITY, maxElevation = -INFINITY;
+
+  void merge(const Summary &other) {
+    points += other.points;
+    waypoints += other.waypoints;
+    tracks += other.tracks;
+    firstTime = std::min(firstTime, other.firstTime);
+    lastTime = std::max(lastTime, other.lastTime);
+    distance_km += other.distance_km;
+    maxSpeed = std::max(maxSpeed, other.maxSpeed);
+    minElevation = std::min(minElevation, other.minElevation);
+    maxElevation = std::max(maxElevation, other.maxElevation);
+  }
+};
+
+struct Columns
+{
+  std::vector<uint32_t> time;
+  std::vector<double> lat, lng;
+  std::vector<float> elevation, speed, course;
+  std::vector<uint8_t> satellites, newTrack;
+};
+
+struct LogFile
+{
+  std::string path, unit;
+  uint32_t day = 0;
+  uint64_t size = 0;
+  uint64_t dataSize = 0;                                      // Without the padding
+  bool ok = false;
+  Summary summary;
+  Columns columns;
+};
+
+// Parsing. The records are short CSV lines of plain decimal numbers, so the fields are split in one pass over
+// the line and the numbers are parsed directly (no strtod/locale). Lines are found with memchr
+static const double pow10Table[19] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+                                      1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18};
+
+static inline double parseNumber(const char *p, const char *end) {
+  while (p < end && *p == ' ') p++;
+  bool negative = (p < end && *p == '-');
+  p += negative;
+  uint64_t mantissa = 0;
+  int fraction = -1;                                          // Digits after the decimal point (-1 - no point yet)
+  for (; p < end; p++) {
+    unsigned digit = (unsigned)(*p - '0');
+    if (digit < 10) {
+      if (fraction < 18) {
+        mantissa = mantissa * 10 + digit;
+        fraction += (fraction >= 0);
+      }
+    } else if (*p == '.' && fraction < 0) fraction = 0;
+    else break;
+  }
+  double value = mantissa / pow10Table[fraction < 0 ? 0 : fraction];
+  return negative ? -value : value;
+}
+
+static inline uint32_t parseTime(const char *p, const char *end) {   // H:M:S (the firmware doesn't zero pad them)
+  while (p < end && *p == ' ') p++;
+  uint32_t seconds = 0, part = 0;
+  for (; p < end; p++) {
+    unsigned digit = (unsigned)(*p - '0');
+    if (digit < 10) part = part * 10 + digit;
+    else if (*p == ':') {
+      seconds = (seconds + part) * 60;
+      part = 0;
+    } else break;
+  }
+  return seconds + part;
+}
+
+// The preallocated end of a file is padding (LOG_PADDING) that the firmware didn't truncate yet (a power loss,
+// or the file of the current day). Like findLogEnd() of the firmware: binary search for the first block of
+// padding only, then back over the padding of the last data block. Only these blocks of the mapping are read
+static bool isPaddingBlock(const char *data, size_t size, size_t block) {
+  size_t from = block * LOG_BLOCK_SIZE, to = std::min(size, from + LOG_BLOCK_SIZE);
+  for (size_t i = from; i < to; i++)
+    if (data[i] != LOG_PADDING) return false;
+  return true;
+}
+
+static size_t logEnd(const char *data, size_t size) {
+  if (size == 0 || data[size - 1] != LOG_PADDING) return size;
+  size_t lo = 0, hi = (size + LOG_BLOCK_SIZE - 1) / LOG_BLOCK_SIZE;
+  while (lo < hi) {
+    size_t mid = (lo + hi) / 2;
+    if (isPaddingBlock(data, size, mid)) hi = mid;
+    else lo = mid + 1;
+  }
+  size_t end = std::min(size, hi * LOG_BLOCK_SIZE);
+  while (end > 0 && data[end - 1] == LOG_PADDING) end--;
+  return end;
+}
+
+static void parseLog(const char *data, size_t size, LogFile &log, bool withColumns) {
+  const char *end = data + size;
+  Summary &sum = log.summary;
+  Columns &cols = log.columns;
+  if (withColumns) cols.time.reserve(size / 96);              // A track point line is about 100 bytes
+  double trackFirstDistance = 0, trackLastDistance = 0;
+
+  for (const char *line = data; line < end;) {
+    const char *eol = (const char *)memchr(line, '\n', end - line);
+    if (!eol) eol = end;
+    const char type = *line;
+
+    if (type == LOG_TRACKPOINT) {
+      const char *f[LOG_FIELD_DESCRIPTION];                   // Start of each field, up to the description
+      int fields = 1;
+      f[LOG_FIELD_TYPE] = line;
+      for (const char *p = line; p < eol && fields < LOG_FIELD_DESCRIPTION; p++)
+        if (*p == ',') f[fields++] = p + 1;
+      while (fields < LOG_FIELD_DESCRIPTION) f[fields++] = eol;
+
+      uint8_t newTrack = (uint8_t)parseNumber(f[LOG_FIELD_NEW_TRACK], eol);
+      double lat = parseNumber(f[LOG_FIELD_LATITUDE], eol);
+      double lng = parseNumber(f[LOG_FIELD_LONGITUDE], eol);
+      uint32_t time = parseTime(f[LOG_FIELD_TIME], eol);
+      uint8_t satellites = (uint8_t)parseNumber(f[LOG_FIELD_SATELLITES], eol);
+      float elevation = (float)parseNumber(f[LOG_FIELD_ELEVATION], eol);
+      float speed = (float)parseNumber(f[LOG_FIELD_SPEED], eol);
+      float course = (float)parseNumber(f[LOG_FIELD_COURSE], eol);
+      double distance = parseNumber(f[LOG_FIELD_DISTANCE], eol);
+
+      if (withColumns) {
+        cols.time.push_back(time);
+        cols.lat.push_back(lat);
+        cols.lng.push_back(lng);
+        cols.elevation.push_back(elevation);
+        cols.speed.push_back(speed);
+        cols.course.push_back(course);
+        cols.satellites.push_back(satellites);
+        cols.newTrack.push_back(newTrack);
+      }
+
+      // The distance field is the total distance since the logger started, so a track's distance is last - first
+      if (newTrack || sum.points == 0) {
+        sum.distance_km += trackLastDistance - trackFirstDistance;
+        trackFirstDistance = distance;
+        sum.tracks++;
+      }
+      trackLastDistance = distance;
+
+      sum.points++;
+      sum.firstTime = std::min(sum.firstTime, time);
+      sum.lastTime = std::max(sum.lastTime, time);
+      sum.maxSpeed = std::max(sum.maxSpeed, speed);
+      sum.minElevation = std::min(sum.minElevation, elevation);
+      sum.maxElevation = std::max(sum.maxElevation, elevation);
+    } else if (type == LOG_WAYPOINT) {
+      sum.waypoints++;
+    }
+    line = eol + 1;
+  }
+  sum.distance_km += trackLastDistance - trackFirstDistance;
+}
+
+static void ingestFile(LogFile &log, bool withColumns) {
+  int fd = open(log.path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    perror(log.path.c_str());
+    return;
+  }
+  struct stat st;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data != MAP_FAILED) {
+      log.dataSize = logEnd((const char *)data, st.st_size);
+      madvise(data, log.dataSize, MADV_SEQUENTIAL);
+      parseLog((const char *)data, log.dataSize, log, withColumns);
+      munmap(data, st.st_size);
+      log.ok = true;
+    } else perror(log.path.c_str());
+  }
+  close(fd);
+}
+
+// Log files are <unit>/gpslog/YYYYMMDD.txt
+static bool isLogFile(const fs::path &path, std::string &unit, uint32_t &day) {
+  std::string name = path.filename().string();
+  if (name.size() != 12 || name.compare(8, 4, ".txt") != 0) return false;
+  for (int i = 0; i < 8; i++) if (name[i] < '0' || name[i] > '9') return false;
+  day = std::stoul(name.substr(0, 8));
+
+  fs::path dir = path.parent_path();
+  if (dir.filename() == LOG_DIRECTORY) dir = dir.parent_path();
+  unit = dir.filename().string();
+  if (unit.empty()) unit = ".";
+  return true;
+}
+
+static void collect(const std::string &arg, std::vector<LogFile> &logs) {
+  auto add = [&logs](const fs::path &path) {
+    LogFile log;
+    if (!isLogFile(path, log.unit, log.day)) return;
+    log.path = path.string();
+    log.size = fs::file_size(path);
+    logs.push_back(std::move(log));
+  };
+
+  std::error_code error;
+  if (fs::is_directory(arg, error)) {
+    for (auto &entry : fs::recursive_directory_iterator(arg, error))
+      if (entry.is_regular_file()) add(entry.path());
+  } else if (fs::is_regular_file(arg, error)) add(arg);
+  else fprintf(stderr, "%s: no such file or directory\n", arg.c_str());
+}
+
+template <class T>
+static void writeColumn(FILE *out, const std::vector<LogFile> &logs, std::vector<T> Columns::*column) {
+  for (const LogFile &log : logs) {
+    const std::vector<T> &values = log.columns.*column;
+    fwrite(values.data(), sizeof(T), values.size(), out);
+  }
+}
+
+template <class T>
+static void writeRepeated(FILE *out, T value, size_t count) {
+  std::vector<T> values(count, value);
+  fwrite(values.data(), sizeof(T), count, out);
+}
+
+static bool writeColumns(const char *path, const std::vector<LogFile> &logs, const std::vector<std::string> &units,
+                         const std::map<std::string, uint16_t> &unitIndex) {
+  FILE *out = fopen(path, "wb");
+  if (!out) {
+    perror(path);
+    return false;
+  }
+  uint64_t rows = 0;
+  for (const LogFile &log : logs) rows += log.columns.time.size();
+  uint32_t unitsCount = units.size();
+  fwrite("GPSCOL01", 1, 8, out);
+  fwrite(&rows, sizeof(rows), 1, out);
+  fwrite(&unitsCount, sizeof(unitsCount), 1, out);
+  for (const std::string &unit : units) {
+    uint16_t length = unit.size();
+    fwrite(&length, sizeof(length), 1, out);
+    fwrite(unit.data(), 1, length, out);
+  }
+
+  for (const LogFile &log : logs)
+    if (!log.columns.time.empty()) writeRepeated<uint16_t>(out, unitIndex.at(log.unit), log.columns.time.size());
+  for (const LogFile &log : logs) writeRepeated<uint32_t>(out, log.day, log.columns.time.size());
+  writeColumn(out, logs, &Columns::time);
+  writeColumn(out, logs, &Columns::lat);
+  writeColumn(out, logs, &Columns::lng);
+  writeColumn(out, logs, &Columns::elevation);
+  writeColumn(out, logs, &Columns::speed);
+  writeColumn(out, logs, &Columns::course);
+  writeColumn(out, logs, &Columns::satellites);
+  writeColumn(out, logs, &Columns::newTrack);
+
+  bool ok = !ferror(out);
+  if (fclose(out) != 0) ok = false;
+  if (!ok) fprintf(stderr, "%s: write failed\n", path);
+  return ok;
+}
+
+static void printTime(FILE *out, uint32_t seconds) {
+  fprintf(out, "%02u:%02u:%02u", seconds / 3600, (seconds / 60) % 60, seconds % 60);
+}
+
+static void writeSummaries(FILE *out, const std::map<std::pair<std::string, uint32_t>, Summary> &summaries) {
+  fprintf(out, "unit, day, track points, waypoints, tracks, first time, last time, distance (km), max speed (kmph), min elevation (m), max elevation (m)\n");
+  for (const auto &entry : summaries) {
+    const Summary &sum = entry.second;
+    fprintf(out, "%s, %u, %llu, %llu, %llu, ", entry.first.first.c_str(), entry.first.second,
+            (unsigned long long)sum.points, (unsigned long long)sum.waypoints, (unsigned long long)sum.tracks);
+    if (sum.points > 0) {
+      printTime(out, sum.firstTime);
+      fprintf(out, ", ");
+      printTime(out, sum.lastTime);
+      fprintf(out, ", %.2f, %.2f, %.2f, %.2f\n", sum.distance_km, sum.maxSpeed, sum.minElevation, sum.maxElevation);
+    } else fprintf(out, ",,,,,\n");
+  }
+}
+
+// Synthetic logs in the firmware's format, for benchmarking: dir/unitNN/gpslog/YYYYMMDD.txt
+// Like the firmware, each power on starts a track: a start waypoint, the end waypoint (rewritten on every fix, in
+// a 50 characters line), then the track points. The description of the first track point is the track summary,
+// padded to 760 characters. Geofence events are waypoints between the track points. The file of the last day of a
+// unit (still being logged) and some others (power lost before the next boot trimmed them) end with up to 4 MB of
+// preallocated padding
+static const int summaryWidth = 760;
+static const size_t maxLogPreallocation = 4194304;
+
+static void appendf(std::string &out, const char *format, ...) __attribute__((format(printf, 2, 3)));
+static void appendf(std::string &out, const char *format, ...) {
+  char buf[1024];
+  va_list args;
+  va_start(args, format);
+  int n = vsnprintf(buf, sizeof(buf), format, args);
+  va_end(args);
+  out.append(buf, std::min(n, (int)sizeof(buf) - 1));
+}
+
+static void appendTime(std::string &out, uint32_t seconds, bool padded) {   // Local time H:M:S, elapsed time H:MM:SS
+  appendf(out, padded ? "%u:%02u:%02u" : "%u:%u:%u", seconds / 3600, (seconds / 60) % 60, seconds % 60);
+}
+
+static int generate(const std::string &dir, int units, int days, int points) {
+  std::mt19937 random(1);
+  std::normal_distribution<double> step(0, 0.00005);
+  std::uniform_real_distribution<double> unit01(0, 1);
+  std::string out;
+  for (int u = 0; u < units; u++) {
+    char unit[16];
+    snprintf(unit, sizeof(unit), "unit%02d", u);
+    fs::path logDir = fs::path(dir) / unit / LOG_DIRECTORY;
+    fs::create_directories(logDir);
+    for (int d = 0; d < days; d++) {
+      uint32_t day = 20180501 + d;
+      out.clear();
+      appendf(out, "Started logging on: %02u/%02u/%04u \r\n%s\r\n", day % 100, (day / 100) % 100, day / 10000, LOG_HEADER);
+
+      int tracks = 1 + random() % 3;
+      uint32_t time = 6 * 3600;
+      for (int t = 0; t < tracks; t++) {
+        double lat = 32.0 + u * 0.01, lng = 34.8, distance = 0, elevation = 50, gain = 0, loss = 0, maxSpeed = 0;
+        uint32_t moving = 0, splitStart = 0, lastSplit = 0, fastestSplit = 0;
+        std::string splits;
+        size_t endPointPos = 0, summaryPos = 0;
+        int trackPoints = points / tracks;
+        for (int i = 0; i < trackPoints; i++, time = (time + 3) % 86400) {
+          double dLat = step(random), dLng = step(random), dElevation = step(random) * 20000;
+          double speed = std::fabs(step(random)) * 100000;
+          lat += dLat;
+          lng += dLng;
+          distance += std::sqrt(dLat * dLat + dLng * dLng) * 111.32;
+          elevation += dElevation;
+          (dElevation > 0 ? gain : loss) += std::fabs(dElevation);
+          maxSpeed = std::max(maxSpeed, speed);
+          if (i > 0 && speed >= 2) moving += 3;
+          if ((int)distance > (int)(distance - std::sqrt(dLat * dLat + dLng * dLng) * 111.32)) {   // A km done
+            lastSplit = i * 3 - splitStart;
+            splitStart = i * 3;
+            if (fastestSplit == 0 || lastSplit < fastestSplit) fastestSplit = lastSplit;
+            appendf(splits, "%u:%02u ", lastSplit / 60, lastSplit % 60);
+          }
+
+          if (i == 0) {
+            appendf(out, "%c,, %.6f, %.6f, ", LOG_WAYPOINT, lat, lng);
+            appendTime(out, time, false);
+            out += ",,,,,,, Start, green\r\n";
+            endPointPos = out.size();
+            out.append(50, ' ');
+            out += "\r\n";
+          }
+          appendf(out, "%c, %d, %.6f, %.6f, ", LOG_TRACKPOINT, i == 0, lat, lng);
+          appendTime(out, time, false);
+          appendf(out, ", %d, %.2f, %.2f, %.2f, ", 5 + i % 7, elevation, speed, std::fmod(std::fabs(step(random)) * 3600000, 360.0));
+          appendTime(out, i * 3, true);
+          appendf(out, ", %.2f", distance);
+          if (i == 0) {
+            summaryPos = out.size();
+            out.append(summaryWidth, ' ');                  // Written when the track ends, as the last rewrite of the firmware
+          }
+          out += "\r\n";
+
+          if (unit01(random) < 0.002) {                       // Geofence event
+            int zone = random() % 20;
+            bool entered = random() % 2;
+            appendf(out, "%c,, %.6f, %.6f, ", LOG_WAYPOINT, lat, lng);
+            appendTime(out, time, false);
+            if (zone < 5) appendf(out, ",,,,,,, %s depot %d, orange\r\n", entered ? "Arrived at" : "Left", zone);
+            else appendf(out, ",,,,,,, %s zone %d, blue\r\n", entered ? "Entered" : "Exited", zone);
+          }
+        }
+        if (trackPoints == 0) continue;
+
+        // The end point and the summary, as last written
+        std::string text;
+        appendf(text, "%c,, %.6f, %.6f, ", LOG_WAYPOINT, lat, lng);
+        appendTime(text, (time + 86397) % 86400, false);
+        text += ",,,,,,, End, red";
+        out.replace(endPointPos, std::min(text.size(), (size_t)50), text, 0, 50);
+
+        uint32_t elapsed = (trackPoints - 1) * 3;
+        text = ", Total tracking time: <b>";
+        appendTime(text, elapsed, true);
+        appendf(text, "</b><br>Total distance (km): <b>%.2f</b><br>Moving time: <b>", distance);
+        appendTime(text, moving, true);
+        text += "</b><br>Stopped time: <b>";
+        appendTime(text, elapsed - moving, true);
+        appendf(text, "</b><br>Average moving speed (kmph): <b>%.2f</b><br>Max speed (kmph): <b>%.2f"
+                "</b><br>Elevation gain/loss (m): <b>+%d/-%d",
+                moving ? distance / (moving / 3600.0) : 0.0, maxSpeed, (int)gain, (int)loss);
+        if (!splits.empty()) {
+          if (splits.size() > 32 * 6) splits = splits.substr(0, splits.rfind(' ', 32 * 6) + 1) + "... ";
+          appendf(text, "</b><br>Km splits: <b>%s</b><br>Last/fastest split: <b>%u:%02u/%u:%02u", splits.c_str(),
+                  lastSplit / 60, lastSplit % 60, fastestSplit / 60, fastestSplit % 60);
+        }
+        text += "</b>";
+        out.replace(summaryPos, std::min(text.size(), (size_t)summaryWidth), text, 0, summaryWidth);
+      }
+
+      if (d == days - 1 || unit01(random) < 0.1)
+        out.append((size_t)(unit01(random) * maxLogPreallocation), LOG_PADDING);
+
+      FILE *file = fopen((logDir / (std::to_string(day) + ".txt")).c_str(), "wb");
+      if (!file || fwrite(out.data(), 1, out.size(), file) != out.size()) {
+        perror(logDir.c_str());
+        return 1;
+      }
+      fclose(file);
+    }
+  }
+  return 0;
+}
+
+static void usage() {
+  fprintf(stderr,
+          "Usage: logingest [options] <log files or directories>...\n"
+          "  -j <threads>    Number of worker threads (default: number of CPUs)\n"
+          "  -s <file>       Write the per-unit/per-day summaries to a file (default: stdout)\n"
+          "  -o <file>       Write the track points to a columnar binary file\n"
+          "  -b              Print the parsing throughput to stderr\n"
+          "       logingest --generate <dir> <units> <days> <points per day>\n"
+          "                  Write synthetic log files for benchmarking\n");
+}
+
+int main(int argc, char **argv) {
+  unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+  const char *summaryPath = nullptr, *columnsPath = nullptr;
+  bool bench = false;
+  std::vector<std::string> inputs;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--generate" && i + 4 < argc)
+      return generate(argv[i + 1], atoi(argv[i + 2]), atoi(argv[i + 3]), atoi(argv[i + 4]));
+    else if (arg == "-j" && i + 1 < argc) threads = std::max(1, atoi(argv[++i]));
+    else if (arg == "-s" && i + 1 < argc) summaryPath = argv[++i];
+    else if (arg == "-o" && i + 1 < argc) columnsPath = argv[++i];
+    else if (arg == "-b") bench = true;
+    else if (arg[0] == '-') {
+      usage();
+      return 2;
+    }
+    else inputs.push_back(arg);
+  }
+  if (inputs.empty()) {
+    usage();
+    return 2;
+  }
+
+  std::vector<LogFile> logs;
+  for (const std::string &input : inputs) collect(input, logs);
+  std::sort(logs.begin(), logs.end(), [](const LogFile &a, const LogFile &b) {
+    return std::tie(a.unit, a.day, a.path) < std::tie(b.unit, b.day, b.path);
+  });
+
+  // Submit the biggest files first, so the small ones fill the gaps at the end
+  std::vector<LogFile *> bySize;
+  for (LogFile &log : logs) bySize.push_back(&log);
+  std::sort(bySize.begin(), bySize.end(), [](const LogFile *a, const LogFile *b) { return a->size > b->size; });
+
+  auto started = std::chrono::steady_clock::now();
+  WorkStealingPool pool(threads);
+  for (LogFile *log : bySize) pool.submit([log, columnsPath]() { ingestFile(*log, columnsPath != nullptr); });
+  pool.run();
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+  // Merge per unit and day, and number the units
+  std::map<std::pair<std::string, uint32_t>, Summary> summaries;
+  std::map<std::string, uint16_t> unitIndex;
+  std::vector<std::string> units;
+  uint64_t bytes = 0, dataBytes = 0, rows = 0;
+  int failed = 0;
+  for (const LogFile &log : logs) {
+    if (!log.ok) {
+      failed += (log.size > 0);
+      continue;
+    }
+    summaries[{log.unit, log.day}].merge(log.summary);
+    if (unitIndex.emplace(log.unit, units.size()).second) units.push_back(log.unit);
+    bytes += log.size;
+    dataBytes += log.dataSize;
+    rows += log.summary.points;
+  }
+
+  if (bench)
+    fprintf(stderr, "%zu files, %.1f MB (%.1f MB of records), %llu track points in %.3f s (%u threads, %u CPUs): "
+            "%.1f MB/s of records, %.1f M points/s\n",
+            logs.size(), bytes / 1e6, dataBytes / 1e6, (unsigned long long)rows, seconds, threads,
+            std::thread::hardware_concurrency(), dataBytes / 1e6 / seconds, rows / 1e6 / seconds);
+
+  FILE *summaryOut = summaryPath ? fopen(summaryPath, "w") : stdout;
+  if (!summaryOut) {
+    perror(summaryPath);
+    return 1;
+  }
+  writeSummaries(summaryOut, summaries);
+  if (summaryPath) fclose(summaryOut);
+
+  if (columnsPath && !writeColumns(columnsPath, logs, units, unitIndex)) return 1;
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,92 @@
+/*
+  previewreplay - host replay of the on-device track preview (TrackPreview.cpp, compiled with the stand-ins of
+  tools/host). Not part of the firmware.
+
+  Reads log files like the /preview page does and prints, for each file, the bytes read (the padding of a
+  preallocated file isn't read), the track points, the vertices, the tracks and polylines, and the time.
+
+  Usage: previewreplay [--selftest] <log files>...
+    --selftest  first check that the decimation keeps the start of every track, also when the last vertex is
+                replaced by the last point of the file
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+#include "TrackPreview.h"
+#include "LogPadding.h"
+
+static TrackPreview preview;
+
+static int polylines() {
+  int starts = 0;
+  for (int i = 0; i < preview.count(); i++) starts += preview.newTrack(i);
+  return starts;
+}
+
+// Two tracks: first points, then second points. Every track start must start a polyline
+static bool checkTracks(const char *path, int first, int second) {
+  FILE *out = fopen(path, "wb");
+  if (!out) {
+    perror(path);
+    return false;
+  }
+  fprintf(out, "%s\r\n", LOG_HEADER);
+  for (int i = 0; i < first + second; i++)
+    fprintf(out, "%c, %d, %.6f, %.6f, 6:0:0, 8, 0.00, 0.00, 0.00, 0:00:00, 0.00\r\n", LOG_TRACKPOINT,
+            i == 0 || i == first, 32.0 + i * 0.00001, 34.8);
+  fclose(out);
+
+  File file = SD.open(path);
+  preview.read(file);
+  file.close();
+  int last = preview.count() - 1;
+  if (polylines() != 2 || preview.lat(last) != (float)(32.0 + (first + second - 1) * 0.00001)) {
+    printf("FAILED: tracks of %d and %d points: %d vertices, %d polylines\n", first, second, preview.count(), polylines());
+    return false;
+  }
+  return true;
+}
+
+static bool selftest() {
+  const char *path = "/tmp/previewreplay-selftest.txt";
+  int checks = 0, failed = 0;
+  for (int first = PREVIEW_MAX_POINTS - 4; first < 4 * PREVIEW_MAX_POINTS + 16; first += 3)
+    for (int second = 1; second <= 9; second++, checks++) failed += !checkTracks(path, first, second);
+  remove(path);
+  printf("selftest: %d checks, %d failed\n", checks, failed);
+  return failed == 0;
+}
+
+int main(int argc, char **argv) {
+  bool ok = true;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--selftest") {
+      ok &= selftest();
+      continue;
+    }
+
+    File file = SD.open(argv[i]);
+    if (!file) {
+      perror(argv[i]);
+      return 1;
+    }
+    unsigned long size = file.size();
+    unsigned long tracks = 0;
+    char line[1024];
+    while (fgets(line, sizeof(line), file.f))                 // Count the tracks, as a reference
+      if (line[0] == LOG_TRACKPOINT && atoi(strchr(line, ',') + 1) == 1) tracks++;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    preview.read(file);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    file.close();
+
+    printf("%s: %lu bytes, %lu read, %lu track points, %d vertices, %lu tracks, %d polylines, %.1f ms\n", argv[i], size,
+           preview.bytesRead(), preview.points(), preview.count(), tracks, polylines(), ms);
+    if ((unsigned long)polylines() != tracks && tracks <= (unsigned long)PREVIEW_MAX_POINTS / 4) ok = false;
+  }
+  return ok ? 0 : 1;
+}
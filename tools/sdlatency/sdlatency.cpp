@@ -0,0 +1,260 @@
+/*
+  sdlatency - replays the log file writes of the firmware on a simulated SD card (tools/host/SD.h, with a cost per
+  block and per cluster allocated), and prints the histogram of the fix write latency (the buckets of
+  recordWriteLatency()) and the longest times the GPS serial isn't fed. Not part of the firmware.
+
+  The log file code of gpsLogger_1.2.ino (CreateLogFile(), PreallocateStep(), FinishLogFile(), smartDelay() and the
+  fix write of loop()) is mirrored here, in three versions:
+    none       no preallocation: the file grows with the fixes
+    stepped    the preallocation before it was reworked: steps of 8 blocks repeated for the first half of every
+               smartDelay() (the GPS fed between steps), all the log files trimmed on every file creation
+    firmware   the firmware now: the first file preallocated before logging starts, then 64 KB to 128 KB of padding
+               kept ahead of the data, one step per smartDelay() (the GPS fed between blocks), trimming at startup only
+  The simulated time is the card's time only (the CPU time of the ESP8266 isn't modelled).
+
+  Usage: sdlatency [-d days] [-p fix period (ms)] [-c cluster allocation (ms)] [-k cluster size (KB)] [-t dir]
+*/
+
+#include <cstdarg>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+
+#include "SD.h"
+#include "LogPadding.h"
+
+namespace fs = std::filesystem;
+
+enum Mode { NONE, STEPPED, FIRMWARE };
+static const char *modeNames[] = {"none", "stepped", "firmware"};
+
+static const unsigned long maxLogPreallocation = 4194304;
+static const int logRecordSize = 112;
+static const int preallocateStepBlocks = 8;
+static const unsigned long preallocateLead = 65536;
+static const int summaryWidth = 760;
+static const unsigned long smartDelayTime = 500;
+static const double gpsBufferTime_ms = 64 * 10 * 1000.0 / 9600;   // 64 bytes of SoftwareSerial buffer at 9600 baud
+
+static const unsigned long latencyBounds[7] = {1, 2, 5, 10, 20, 50, 100};
+
+struct Logger
+{
+  Mode mode;
+  unsigned long fixPeriod;
+  std::string directory, filePath;
+  unsigned long logEndPos = 0, logFileSize = 0, logAllocated = 0;
+  bool logCardFull = false, isFileCreated = false;
+  int newTrack = 1;
+  unsigned long pos = 0, endPointPos = 0;
+
+  // Results
+  unsigned long histogram[8] = {0};
+  unsigned long fixes = 0;
+  double maxFix_ms = 0, maxFeedGap_ms = 0, boot_ms = 0;
+  unsigned long feedGapsOver = 0;                             // Times the GPS serial wasn't fed for longer than its buffer
+  double lastFeed_ms = 0;
+
+  void feedGps() {
+    double gap = hostCard.clock_ms - lastFeed_ms;
+    if (gap > gpsBufferTime_ms) feedGapsOver++;
+    maxFeedGap_ms = max(maxFeedGap_ms, gap);
+    lastFeed_ms = hostCard.clock_ms;
+  }
+
+  unsigned long logPreallocationSize() {
+    unsigned long bytes = (86400000UL / fixPeriod) * logRecordSize;
+    return min(bytes, maxLogPreallocation);
+  }
+
+  void preallocateStep(unsigned long blocks) {
+    File file = SD.open(filePath.c_str(), FILE_WRITE);
+    if (!file) {
+      logAllocated = 0;
+      return;
+    }
+    unsigned long size = file.size();
+    char buf[LOG_BLOCK_SIZE];
+    memset(buf, LOG_PADDING, LOG_BLOCK_SIZE);
+    file.seek(size);
+    for (unsigned long i = 0; i < blocks && size < logAllocated; i++) {
+      unsigned long n = min((unsigned long)LOG_BLOCK_SIZE, logAllocated - size);
+      file.write((uint8_t *)buf, n);
+      size += n;
+      if (mode == FIRMWARE) feedGps();
+    }
+    file.close();
+    logFileSize = size;
+    if (size >= logAllocated) logAllocated = 0;
+  }
+
+  void smartDelay() {
+    double start = hostCard.clock_ms;
+    if (mode == FIRMWARE) {
+      if (logAllocated == 0 && isFileCreated && !logCardFull && logEndPos + preallocateLead > logFileSize)
+        logAllocated = logEndPos + 2 * preallocateLead;
+      if (logAllocated != 0) preallocateStep(preallocateStepBlocks);
+    }
+    else if (mode == STEPPED) {
+      while (logAllocated != 0 && hostCard.clock_ms - start < smartDelayTime / 2) {
+        feedGps();
+        preallocateStep(preallocateStepBlocks);
+      }
+    }
+    feedGps();
+  }
+
+  void finishLogFile() {
+    logAllocated = 0;
+    File file = SD.open(filePath.c_str(), FILE_WRITE);
+    if (file) {
+      if (file.size() > logEndPos) file.truncate(logEndPos);
+      logFileSize = logEndPos;
+      file.close();
+    }
+  }
+
+  void createLogFile(const std::string &path, const std::string &date) {
+    if (mode == STEPPED) trimLogFiles(String(directory.c_str()), String(path.c_str()));
+    filePath = path;
+    if (SD.exists(path.c_str())) {
+      logEndPos = logFileSize = findLogEnd(String(path.c_str()));
+      logCardFull = false;
+      if (mode == STEPPED) logAllocated = logEndPos + logPreallocationSize();
+      return;
+    }
+    File file = SD.open(path.c_str(), FILE_WRITE);
+    std::string header = "Started logging on: " + date + " \r\n" + LOG_HEADER + "\r\n";
+    file.write((const uint8_t *)header.data(), header.size());
+    logEndPos = logFileSize = file.position();
+    logCardFull = false;
+    if (mode == STEPPED) logAllocated = logEndPos + logPreallocationSize();
+    file.close();
+  }
+
+  void write(File &file, const char *format, ...) __attribute__((format(printf, 3, 4))) {
+    char buf[1024];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    file.write((const uint8_t *)buf, n);
+  }
+
+  // One fix of loop(): the rollover, the track point, the summary and the end point
+  void fix(unsigned long day, unsigned long seconds, bool rollover) {
+    double start = hostCard.clock_ms;
+    char path[64], date[32];
+    snprintf(path, sizeof(path), "%s/%lu.txt", directory.c_str(), day);
+    snprintf(date, sizeof(date), "%02lu/%02lu/%04lu", day % 100, (day / 100) % 100, day / 10000);
+    if (rollover) {
+      finishLogFile();
+      newTrack = 1;
+      createLogFile(path, date);
+    }
+
+    double lat = 32.0 + fixes * 1e-6, lng = 34.8 + fixes * 1e-6;
+    unsigned h = seconds / 3600, m = (seconds / 60) % 60, s = seconds % 60;
+    File file = SD.open(filePath.c_str(), FILE_WRITE);
+    file.seek(logEndPos);
+    if (newTrack) {
+      write(file, "W,, %.6f, %.6f, %u:%u:%u,,,,,,, Start, green\r\n", lat, lng, h, m, s);
+      endPointPos = file.position();
+      write(file, "%50s\r\n", "");
+    }
+    write(file, "T, %d, %.6f, %.6f, %u:%u:%u, 8, 123.40, 45.67, 123.45, %lu:%02lu:%02lu, %.2f\r\n", newTrack, lat, lng,
+          h, m, s, fixes / 3600, (fixes / 60) % 60, fixes % 60, fixes * 0.01);
+    logEndPos = file.position();
+    if (newTrack) pos = file.position() - 2;
+    file.seek(pos);
+    write(file, "%-*s\r\n", summaryWidth, ", Total tracking time: <b>1:23:45</b><br>Total distance (km): <b>12.34</b>...");
+    if (file.position() > logEndPos) logEndPos = file.position();
+    file.seek(endPointPos);
+    write(file, "W,, %.6f, %.6f, %u:%u:%u,,,,,,, End, red", lat, lng, h, m, s);
+    file.close();
+    if (logEndPos > logFileSize) logFileSize = logEndPos;
+    newTrack = 0;
+
+    double ms = hostCard.clock_ms - start;
+    int bucket = 0;
+    while (bucket < 7 && ms >= latencyBounds[bucket]) bucket++;
+    histogram[bucket]++;
+    maxFix_ms = max(maxFix_ms, ms);
+    fixes++;
+    feedGps();                                                // The fix write is also a time the GPS isn't fed
+  }
+
+  void run(unsigned long days) {
+    // Boot at 08:00 of the first day, log every fixPeriod until 08:00 of the last day
+    hostCard.clock_ms = lastFeed_ms = 0;
+    double bootStart = hostCard.clock_ms;
+    if (mode == FIRMWARE) trimLogFiles(String(directory.c_str()), String(""));
+    createLogFile(directory + "/20180501.txt", "01/05/2018");
+    isFileCreated = true;
+    if (mode == FIRMWARE) {
+      logAllocated = logEndPos + logPreallocationSize();
+      preallocateStep(~0UL);
+    }
+    boot_ms = hostCard.clock_ms - bootStart;
+    lastFeed_ms = hostCard.clock_ms;
+
+    unsigned long day = 20180501;
+    unsigned long long t_ms = 8 * 3600 * 1000ULL, end_ms = (days * 24 + 8) * 3600 * 1000ULL;
+    for (; t_ms < end_ms; t_ms += fixPeriod) {
+      unsigned long dayIndex = t_ms / 86400000ULL, seconds = (t_ms / 1000) % 86400;
+      unsigned long today = 20180501 + dayIndex;                // May has 31 days: keep the runs within it
+      fix(today, seconds, today != day);
+      day = today;
+      smartDelay();
+    }
+  }
+
+  void print() {
+    printf("%-9s %7lu fixes, boot %8.0f ms, fix write:", modeNames[mode], fixes, boot_ms);
+    for (int i = 0; i < 8; i++) {
+      if (i < 7) printf(" <%lu:%lu", latencyBounds[i], histogram[i]);
+      else printf(" >=100:%lu", histogram[i]);
+    }
+    printf(", max %.0f ms; GPS not fed: max %.0f ms, %lu times over %.0f ms\n", maxFix_ms, maxFeedGap_ms, feedGapsOver,
+           gpsBufferTime_ms);
+  }
+};
+
+int main(int argc, char **argv) {
+  unsigned long days = 2, fixPeriod = 1000;
+  std::string dir = "/tmp/sdlatency";
+  hostCard.open_ms = 1;
+  hostCard.close_ms = 2;
+  hostCard.blockRead_ms = 0.5;
+  hostCard.blockWrite_ms = 1;
+  hostCard.clusterAllocate_ms = 100;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    std::string arg = argv[i];
+    if (arg == "-d") days = atol(argv[i + 1]);
+    else if (arg == "-p") fixPeriod = atol(argv[i + 1]);
+    else if (arg == "-c") hostCard.clusterAllocate_ms = atof(argv[i + 1]);
+    else if (arg == "-k") hostCard.clusterSize = atol(argv[i + 1]) * 1024;
+    else if (arg == "-t") dir = argv[i + 1];
+    else {
+      fprintf(stderr, "Usage: sdlatency [-d days] [-p fix period (ms)] [-c cluster allocation (ms)] [-k cluster size (KB)] [-t dir]\n");
+      return 2;
+    }
+  }
+  if (days < 1 || days > 30) days = 2;
+
+  printf("card: open %.1f ms, close %.1f ms, block read %.1f ms, block write %.1f ms, cluster (%lu KB) allocation %.0f ms; "
+         "fix every %lu ms for %lu days\n", hostCard.open_ms, hostCard.close_ms, hostCard.blockRead_ms, hostCard.blockWrite_ms,
+         hostCard.clusterSize / 1024, hostCard.clusterAllocate_ms, fixPeriod, days);
+  for (Mode mode : {NONE, STEPPED, FIRMWARE}) {
+    fs::remove_all(dir);
+    fs::create_directories(dir + "/" + LOG_DIRECTORY);
+    Logger logger;
+    logger.mode = mode;
+    logger.fixPeriod = fixPeriod;
+    logger.directory = dir + "/" + LOG_DIRECTORY;
+    logger.run(days);
+    logger.print();
+  }
+  fs::remove_all(dir);
+  return 0;
+}